@@ -8,6 +8,33 @@
 #include <stdexcept> // Required for exception handling
 #include <limits>   // Required for numeric limits
 #include <iomanip>  // Required for formatting output
+#include <array>    // Required for fixed-size constexpr tables
+#include <string_view> // Required for constexpr string handling in the command grammar
+#include <cstdint>  // Required for fixed-width integer types
+#include <memory>   // Required for smart pointers
+#include <thread>   // Required for the per-shard worker threads
+#include <mutex>    // Required for guarding worker task queues
+#include <condition_variable> // Required for waking worker threads
+#include <future>   // Required for collecting results from worker threads
+#include <functional> // Required for storing queued tasks
+#include <queue>    // Required for worker task queues
+#include <atomic>   // Required for lock-free queues and counters
+#include <chrono>   // Required for measuring pipeline throughput
+#include <random>   // Required for generating simulated orders
+#include <sstream>  // Required for building file names and store records
+#include <filesystem> // Required for managing the key-value store's files
+#include <cstring>  // Required for memcmp (catalog snapshot header check)
+#include <cmath>    // Required for rounding blended ratings
+#include <cstdlib>  // Required for getenv and mkstemp (catalog snapshot cache)
+#ifdef __linux__
+#include <pthread.h> // Required for pinning worker threads to cores
+#endif
+#ifdef __unix__
+#include <fcntl.h>  // Required for opening files to sync them
+#include <unistd.h> // Required for fsync
+#include <sys/mman.h> // Required for mapping the catalog snapshot
+#include <sys/stat.h> // Required for finding the snapshot's size
+#endif
 
 using namespace std; // Using the standard namespace to avoid prefixing std::
 
@@ -19,6 +46,29 @@ string toLower(string str)
     return str; // Returns the lowercase string
 }
 
+// Helper function to remove leading and trailing whitespace
+string trim(const string &str)
+{
+    size_t first = str.find_first_not_of(" \t");
+    if (first == string::npos)
+        return "";
+    return str.substr(first, str.find_last_not_of(" \t") - first + 1);
+}
+
+// Helper function to split a tab-separated record into its fields
+vector<string> splitFields(const string &record)
+{
+    vector<string> fields;
+    size_t start = 0, tab;
+    while ((tab = record.find('\t', start)) != string::npos)
+    {
+        fields.push_back(record.substr(start, tab - start));
+        start = tab + 1;
+    }
+    fields.push_back(record.substr(start));
+    return fields;
+}
+
 // Helper function to validate numeric input
 double getValidPrice()
 {
@@ -39,6 +89,382 @@ double getValidPrice()
     }
 }
 
+// -------------------- Command Grammar --------------------
+// Every command ChefBot understands is described once in the constexpr tables
+// below. The matcher, the keyword lookup and both help screens are generated
+// from them, and static_asserts check that every help example parses to the
+// command it documents and that every trigger appears in the help, so the
+// guide cannot drift from the parser.
+
+// Commands in dispatch priority order (earlier entries win when several match)
+enum class Command
+{
+    Exit,
+    Help,
+    Login,
+    Rate,
+    Reviews,
+    Reorder,
+    History,
+    Cart,
+    KitchenStatus,
+    Simulate,
+    Deals,
+    StartupReport,
+    Recommend,
+    Order,
+    OpenStatus,
+    TellAbout,
+    NearestBranch,
+    Unknown
+};
+
+// A single entry of the command grammar
+struct CommandSpec
+{
+    Command id;                     // Command selected by this entry
+    bool exact;                     // True if the whole input must equal a trigger
+    array<string_view, 4> triggers; // Trigger phrases; '+' joins phrases that must all appear
+};
+
+// The command grammar, checked top to bottom
+constexpr array<CommandSpec, 17> commandTable = {{
+    {Command::Exit, true, {"exit", "quit", "bye", "goodbye"}},
+    {Command::Help, true, {"help", "commands", "what can you do"}},
+    {Command::Login, false, {"login", "my name is"}},
+    {Command::Rate, false, {"rate"}},
+    {Command::Reviews, false, {"review", "reviews"}},
+    {Command::Reorder, false, {"reorder", "repeat my last order", "order again"}},
+    {Command::History, false, {"my orders", "order history", "my last+orders"}},
+    {Command::Cart, false, {"my cart", "saved cart"}},
+    {Command::KitchenStatus, false, {"kitchen status", "pipeline status"}},
+    {Command::Simulate, false, {"simulate"}},
+    {Command::Deals, false, {"deals", "promotions", "coupons"}},
+    {Command::StartupReport, false, {"startup"}},
+    {Command::Recommend, false, {"recommend", "tell me about+under"}},
+    {Command::Order, false, {"order"}},
+    {Command::OpenStatus, false, {"open now", "open status"}},
+    {Command::TellAbout, false, {"tell me about"}},
+    {Command::NearestBranch, false, {"nearest", "branch", "branches"}},
+}};
+
+// Letters and digits make up words; everything else separates them
+constexpr bool isWordChar(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9');
+}
+
+// Checks whether a phrase appears in the input as whole words, so "rate" does not match "separate"
+constexpr bool containsWords(string_view input, string_view phrase)
+{
+    for (size_t pos = input.find(phrase); pos != string_view::npos; pos = input.find(phrase, pos + 1))
+    {
+        size_t end = pos + phrase.size();
+        if ((pos == 0 || !isWordChar(input[pos - 1])) && (end == input.size() || !isWordChar(input[end])))
+            return true;
+    }
+    return false;
+}
+
+// Checks whether every '+'-separated phrase of a trigger appears in the input as whole words
+constexpr bool containsAll(string_view input, string_view trigger)
+{
+    while (!trigger.empty())
+    {
+        size_t plus = trigger.find('+');
+        if (!containsWords(input, trigger.substr(0, plus)))
+            return false;
+        trigger = (plus == string_view::npos) ? string_view() : trigger.substr(plus + 1);
+    }
+    return true;
+}
+
+// Maps lowercase input to the first command whose triggers match it
+constexpr Command parseCommand(string_view input)
+{
+    for (const auto &spec : commandTable)
+    {
+        for (const auto &trigger : spec.triggers)
+        {
+            if (trigger.empty())
+                continue;
+            if (spec.exact ? input == trigger : containsAll(input, trigger))
+                return spec.id;
+        }
+    }
+    return Command::Unknown;
+}
+
+// Kinds of keywords that act as command parameters
+enum class KeywordKind
+{
+    Restaurant,
+    Food,
+    Field
+};
+
+// A parameter keyword; value indexes the matching parameter list below
+struct Keyword
+{
+    string_view word;
+    KeywordKind kind;
+    int value;
+};
+
+// Parameter values, in priority order when several appear in one input
+constexpr array<string_view, 3> restaurantKeywords = {"cheezious", "ranchers", "howdy"};
+constexpr array<string_view, 5> foodKeywords = {"burger", "pizza", "pasta", "wrap", "sandwich"};
+constexpr array<string_view, 7> fieldKeywords = {"name", "address", "menu", "branches", "rating", "prices", "restaurants"};
+
+// Every accepted spelling of a parameter keyword
+constexpr array<Keyword, 25> keywordTable = {{
+    {"cheezious", KeywordKind::Restaurant, 0},
+    {"ranchers", KeywordKind::Restaurant, 1},
+    {"howdy", KeywordKind::Restaurant, 2},
+    {"burger", KeywordKind::Food, 0},
+    {"burgers", KeywordKind::Food, 0},
+    {"pizza", KeywordKind::Food, 1},
+    {"pizzas", KeywordKind::Food, 1},
+    {"pasta", KeywordKind::Food, 2},
+    {"pastas", KeywordKind::Food, 2},
+    {"wrap", KeywordKind::Food, 3},
+    {"wraps", KeywordKind::Food, 3},
+    {"sandwich", KeywordKind::Food, 4},
+    {"sandwiches", KeywordKind::Food, 4},
+    {"name", KeywordKind::Field, 0},
+    {"names", KeywordKind::Field, 0},
+    {"address", KeywordKind::Field, 1},
+    {"addresses", KeywordKind::Field, 1},
+    {"menu", KeywordKind::Field, 2},
+    {"menus", KeywordKind::Field, 2},
+    {"branches", KeywordKind::Field, 3},
+    {"rating", KeywordKind::Field, 4},
+    {"ratings", KeywordKind::Field, 4},
+    {"prices", KeywordKind::Field, 5},
+    {"restaurant", KeywordKind::Field, 6},
+    {"restaurants", KeywordKind::Field, 6},
+}};
+
+constexpr size_t keywordSlotCount = 128; // Size of the perfect hash table (power of two)
+
+// Seeded FNV-1a hash used for the keyword perfect hash
+constexpr uint32_t keywordHash(string_view word, uint32_t seed)
+{
+    uint32_t hash = 2166136261u ^ seed;
+    for (char c : word)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 16777619u;
+    }
+    hash ^= hash >> 15; // Mix the high bits down so the slot index depends on the seed
+    hash *= 0x2c1b3c6du;
+    hash ^= hash >> 12;
+    return hash;
+}
+
+// Searches for a seed that sends every keyword to its own slot
+constexpr uint32_t findKeywordSeed()
+{
+    for (uint32_t seed = 0; seed < 100000; seed++)
+    {
+        array<bool, keywordSlotCount> used{};
+        bool collision = false;
+        for (const auto &keyword : keywordTable)
+        {
+            size_t slot = keywordHash(keyword.word, seed) & (keywordSlotCount - 1);
+            if (used[slot])
+            {
+                collision = true;
+                break;
+            }
+            used[slot] = true;
+        }
+        if (!collision)
+            return seed;
+    }
+    return 0;
+}
+
+constexpr uint32_t keywordSeed = findKeywordSeed();
+
+// Builds the slot -> keyword index table (-1 for empty slots)
+constexpr array<int, keywordSlotCount> buildKeywordSlots()
+{
+    array<int, keywordSlotCount> slots{};
+    for (auto &slot : slots)
+        slot = -1;
+    for (size_t i = 0; i < keywordTable.size(); i++)
+        slots[keywordHash(keywordTable[i].word, keywordSeed) & (keywordSlotCount - 1)] = static_cast<int>(i);
+    return slots;
+}
+
+constexpr array<int, keywordSlotCount> keywordSlots = buildKeywordSlots();
+
+// Looks up a single word in the keyword table with one probe
+constexpr const Keyword *lookupKeyword(string_view word)
+{
+    int index = keywordSlots[keywordHash(word, keywordSeed) & (keywordSlotCount - 1)];
+    if (index < 0 || keywordTable[index].word != word)
+        return nullptr;
+    return &keywordTable[index];
+}
+
+// Returns a bitmask of the keyword values of one kind mentioned in the input
+constexpr unsigned keywordMask(string_view input, KeywordKind kind)
+{
+    unsigned mask = 0;
+    size_t pos = 0;
+    while (pos < input.size())
+    {
+        size_t end = pos;
+        while (end < input.size() && isWordChar(input[end]))
+            end++;
+        if (end > pos)
+        {
+            const Keyword *keyword = lookupKeyword(input.substr(pos, end - pos));
+            if (keyword != nullptr && keyword->kind == kind)
+                mask |= 1u << keyword->value;
+        }
+        pos = end + 1;
+    }
+    return mask;
+}
+
+// Returns the highest-priority keyword value of one kind in the input, or -1
+constexpr int firstKeyword(string_view input, KeywordKind kind)
+{
+    unsigned mask = keywordMask(input, kind);
+    for (int value = 0; value < 32; value++)
+    {
+        if (mask & (1u << value))
+            return value;
+    }
+    return -1;
+}
+
+// A line of the help guide
+struct HelpEntry
+{
+    string_view section;             // Heading the entry is listed under
+    string_view usage;               // What the user types ('[...]' marks a placeholder)
+    string_view description;         // What the command does
+    Command command;                 // Command the usage is parsed to
+    array<string_view, 3> examples;  // Concrete inputs for placeholder usages, or other phrasings
+    string_view quick;               // Short description for the quick list (empty to omit)
+};
+
+// The help guide, grouped by section in display order
+constexpr array<HelpEntry, 32> helpTable = {{
+    {"INFORMATION COMMANDS", "tell me about restaurants", "Show all restaurant info", Command::TellAbout, {}, "Show all info"},
+    {"INFORMATION COMMANDS", "tell me about [restaurant name]", "Show specific restaurant", Command::TellAbout,
+     {"tell me about cheezious", "tell me about ranchers", "tell me about howdy"}, ""},
+    {"INFORMATION COMMANDS", "tell me about names", "Show restaurant names", Command::TellAbout, {}, ""},
+    {"INFORMATION COMMANDS", "tell me about ratings", "Show restaurant ratings", Command::TellAbout, {}, ""},
+    {"INFORMATION COMMANDS", "reviews [restaurant name]", "Show rating breakdown and recent reviews", Command::Reviews,
+     {"reviews cheezious", "review howdy"}, ""},
+    {"INFORMATION COMMANDS", "tell me about menu", "Show all menus", Command::TellAbout, {}, ""},
+    {"INFORMATION COMMANDS", "tell me about addresses", "Show all addresses", Command::TellAbout, {}, ""},
+    {"INFORMATION COMMANDS", "tell me about branches", "Show all branches", Command::TellAbout, {}, ""},
+    {"ORDERING COMMANDS", "order", "Start the ordering process", Command::Order, {}, "Place an order"},
+    {"ORDERING COMMANDS", "place order", "Alternative ordering command", Command::Order, {}, ""},
+    {"RECOMMENDATION COMMANDS", "recommend", "Show all items under Rs 500", Command::Recommend,
+     {"tell me about burgers under 500"}, "Get recommendations under Rs 500"},
+    {"RECOMMENDATION COMMANDS", "recommend burger", "Show burger recommendations", Command::Recommend, {}, ""},
+    {"RECOMMENDATION COMMANDS", "recommend pizza", "Show pizza recommendations", Command::Recommend, {}, ""},
+    {"RECOMMENDATION COMMANDS", "recommend pasta", "Show pasta recommendations", Command::Recommend, {}, ""},
+    {"RECOMMENDATION COMMANDS", "recommend wrap", "Show wrap recommendations", Command::Recommend, {}, ""},
+    {"RECOMMENDATION COMMANDS", "recommend sandwich", "Show sandwich recommendations", Command::Recommend, {}, ""},
+    {"RECOMMENDATION COMMANDS", "deals", "Show current deals, bundles and coupons", Command::Deals,
+     {"promotions", "coupons"}, ""},
+    {"LOCATION COMMANDS", "nearest branch", "Find branches in your city", Command::NearestBranch, {}, "Find branches near you"},
+    {"LOCATION COMMANDS", "find branches", "Alternative branch finder", Command::NearestBranch, {}, ""},
+    {"STATUS COMMANDS", "[restaurant name] open now", "Check if restaurant is open", Command::OpenStatus,
+     {"cheezious open now", "ranchers open status", "howdy open now"}, "Check opening status"},
+    {"ACCOUNT COMMANDS", "login [your name]", "Sign in so ChefBot remembers your orders", Command::Login,
+     {"login ali", "my name is sara"}, ""},
+    {"ACCOUNT COMMANDS", "my orders", "Show your last 5 orders", Command::History,
+     {"my last 10 orders", "order history"}, "See your recent orders"},
+    {"ACCOUNT COMMANDS", "reorder", "Repeat your last order", Command::Reorder, {"repeat my last order", "order again"}, ""},
+    {"ACCOUNT COMMANDS", "my cart", "Show the item you left without confirming", Command::Cart, {"saved cart"}, ""},
+    {"ACCOUNT COMMANDS", "rate", "Rate your last order and leave a short review", Command::Rate, {"rate my last order"}, ""},
+    {"KITCHEN COMMANDS", "kitchen status", "Show order pipeline throughput and branch load", Command::KitchenStatus,
+     {"pipeline status"}, ""},
+    {"KITCHEN COMMANDS", "simulate [number] orders", "Load-test the pipeline with simulated orders", Command::Simulate,
+     {"simulate 5000 orders"}, ""},
+    {"SYSTEM COMMANDS", "startup report", "Show how long start-up and the first query took", Command::StartupReport, {}, ""},
+    {"SYSTEM COMMANDS", "simulate [number] ratings", "Stress-test concurrent rating submission", Command::Simulate,
+     {"simulate 100000 ratings"}, ""},
+    {"HELP & EXIT", "help", "Show this command guide", Command::Help, {"what can you do"}, "Show full command guide"},
+    {"HELP & EXIT", "commands", "Show available commands", Command::Help, {}, ""},
+    {"HELP & EXIT", "exit", "Quit ChefBot", Command::Exit, {"quit", "bye", "goodbye"}, "Quit ChefBot"},
+}};
+
+// Checks that every help usage and example is parsed to the command it documents
+constexpr bool helpMatchesGrammar()
+{
+    for (const auto &entry : helpTable)
+    {
+        if (entry.usage.find('[') == string_view::npos && parseCommand(entry.usage) != entry.command)
+            return false;
+        for (const auto &example : entry.examples)
+        {
+            if (!example.empty() && parseCommand(example) != entry.command)
+                return false;
+        }
+    }
+    return true;
+}
+
+// Checks that every trigger of the grammar appears in a help usage or example of its command
+constexpr bool everyTriggerDocumented()
+{
+    for (const auto &spec : commandTable)
+    {
+        for (const auto &trigger : spec.triggers)
+        {
+            if (trigger.empty())
+                continue;
+            bool documented = false;
+            for (const auto &entry : helpTable)
+            {
+                if (entry.command != spec.id)
+                    continue;
+                if (containsAll(entry.usage, trigger))
+                    documented = true;
+                for (const auto &example : entry.examples)
+                {
+                    if (!example.empty() && containsAll(example, trigger))
+                        documented = true;
+                }
+            }
+            if (!documented)
+                return false;
+        }
+    }
+    return true;
+}
+
+// Checks that every keyword resolves to itself, i.e. the hash is collision-free
+constexpr bool keywordHashIsPerfect()
+{
+    for (const auto &keyword : keywordTable)
+    {
+        if (lookupKeyword(keyword.word) != &keyword)
+            return false;
+    }
+    return true;
+}
+
+static_assert(keywordHashIsPerfect(), "No collision-free keyword hash seed found");
+static_assert(helpMatchesGrammar(), "Help table has drifted from the command grammar");
+static_assert(everyTriggerDocumented(), "A command trigger is missing from the help table");
+static_assert(firstKeyword("recommend burgers", KeywordKind::Food) == 0, "Food keyword lookup is broken");
+static_assert(firstKeyword("tell me about branches", KeywordKind::Field) == 3, "Field keyword lookup is broken");
+static_assert(parseCommand("recommend something moderately priced") == Command::Recommend &&
+                  parseCommand("tell me about separate menus") == Command::TellAbout &&
+                  parseCommand("place order for my last meal") == Command::Order,
+              "Triggers must match whole words only");
+
 // -------------------- MenuItem Class --------------------
 // Represents a single item on a restaurant's menu
 class MenuItem
@@ -60,8 +486,161 @@ public:
     {
         cout << "   - " << name << ": Rs " << price << endl;
     }
+
+    // Displays the menu item with its current price, noting any discount
+    void show(double currentPrice) const
+    {
+        if (currentPrice >= price)
+            return show();
+        cout << "   - " << name << ": Rs " << currentPrice << " (was Rs " << price << ")" << endl;
+    }
+};
+
+// -------------------- Ratings and Reviews --------------------
+// Customer ratings are aggregated without locks. Each aggregate keeps its star
+// counters in several cache-line-sized stripes; a rating is one relaxed atomic
+// add to the submitting thread's own stripe, and a reader sums the stripes with
+// atomic loads. Neither side ever waits on the other. Count and mean are derived
+// from the star distribution rather than stored beside it, so a snapshot's count,
+// mean and distribution always describe the same set of ratings.
+
+// A point-in-time view of one rating aggregate
+struct RatingSnapshot
+{
+    array<uint64_t, 5> stars{}; // Number of 1- to 5-star ratings
+    uint64_t count = 0;         // Total number of ratings
+    double mean = 0;            // Average stars (0 if there are no ratings)
+
+    // Blends the ratings with a catalog rating worth priorWeight ratings, rounded to one decimal
+    float blendedWith(float prior, double priorWeight = 20) const
+    {
+        double blended = (prior * priorWeight + mean * count) / (priorWeight + count);
+        return static_cast<float>(round(blended * 10) / 10);
+    }
+};
+
+// Lock-free star counters for one restaurant or menu item
+class RatingStats
+{
+    static constexpr size_t stripeCount = 8; // Concurrent raters rarely share a stripe's cache line
+
+    struct alignas(64) Stripe
+    {
+        array<atomic<uint64_t>, 5> stars; // Ratings per star value added through this stripe
+    };
+
+    array<Stripe, stripeCount> stripes;
+
+    // Stripe of the calling thread; threads are spread over the stripes round-robin
+    static size_t stripeOfThisThread()
+    {
+        static atomic<size_t> nextStripe{0};
+        thread_local size_t stripe = nextStripe.fetch_add(1, memory_order_relaxed) % stripeCount;
+        return stripe;
+    }
+
+public:
+    // Constructor starts every counter at zero
+    RatingStats()
+    {
+        for (auto &stripe : stripes)
+        {
+            for (auto &counter : stripe.stars)
+                counter.store(0, memory_order_relaxed);
+        }
+    }
+
+    RatingStats(const RatingStats &) = delete;
+    RatingStats &operator=(const RatingStats &) = delete;
+
+    // Records ratings of 1 to 5 stars; wait-free
+    void add(int stars, uint64_t times = 1)
+    {
+        stripes[stripeOfThisThread()].stars[stars - 1].fetch_add(times, memory_order_relaxed);
+    }
+
+    // Sums the stripes into a snapshot; wait-free. Counters only grow, so
+    // successive snapshots taken by one thread never go backwards.
+    RatingSnapshot snapshot() const
+    {
+        RatingSnapshot view;
+        for (const auto &stripe : stripes)
+        {
+            for (size_t s = 0; s < 5; s++)
+                view.stars[s] += stripe.stars[s].load(memory_order_relaxed);
+        }
+        uint64_t total = 0;
+        for (size_t s = 0; s < 5; s++)
+        {
+            view.count += view.stars[s];
+            total += view.stars[s] * (s + 1);
+        }
+        view.mean = view.count ? static_cast<double>(total) / view.count : 0;
+        return view;
+    }
+};
+
+// Rating aggregates for every restaurant and menu item in the catalog
+class RatingBoard
+{
+    vector<unique_ptr<RatingStats>> restaurantStats; // Indexed like the catalog's restaurants
+    vector<unique_ptr<RatingStats>> itemStats;       // Indexed by item id (see PromotionEngine)
+
+public:
+    // Constructor creates an empty aggregate per restaurant and per item
+    RatingBoard(size_t restaurants, size_t items)
+    {
+        for (size_t r = 0; r < restaurants; r++)
+            restaurantStats.push_back(make_unique<RatingStats>());
+        for (size_t i = 0; i < items; i++)
+            itemStats.push_back(make_unique<RatingStats>());
+    }
+
+    RatingStats &restaurant(size_t r) { return *restaurantStats[r]; }
+    const RatingStats &restaurant(size_t r) const { return *restaurantStats[r]; }
+    RatingStats &item(size_t id) { return *itemStats[id]; }
+    const RatingStats &item(size_t id) const { return *itemStats[id]; }
+
+    // Records one rating of an item and its restaurant; safe from any thread
+    void submit(size_t restaurant, size_t item, int stars)
+    {
+        itemStats[item]->add(stars);
+        restaurantStats[restaurant]->add(stars);
+    }
 };
 
+// Formats a star distribution as "c1,c2,c3,c4,c5" for the store
+string encodeStars(const RatingSnapshot &view)
+{
+    string text;
+    for (size_t s = 0; s < 5; s++)
+        text += (s ? "," : "") + to_string(view.stars[s]);
+    return text;
+}
+
+// Adds a distribution stored by encodeStars back into an aggregate. Throws
+// invalid_argument or out_of_range, adding nothing, if the text is malformed.
+void addEncodedStars(RatingStats &stats, const string &text)
+{
+    array<uint64_t, 5> counts{};
+    istringstream in(text);
+    string count;
+    size_t fields = 0;
+    while (getline(in, count, ','))
+    {
+        if (fields == counts.size() || count.empty() || count.find_first_not_of("0123456789") != string::npos)
+            throw invalid_argument("bad star counts '" + text + "'");
+        counts[fields++] = stoull(count);
+    }
+    if (fields != counts.size())
+        throw invalid_argument("bad star counts '" + text + "'");
+    for (size_t s = 0; s < counts.size(); s++)
+    {
+        if (counts[s] > 0)
+            stats.add(static_cast<int>(s) + 1, counts[s]);
+    }
+}
+
 // -------------------- Restaurant Base Class --------------------
 // Base class for all restaurants, defining common properties and behaviors
 class Restaurant
@@ -72,31 +651,41 @@ protected:
     vector<string> addresses;               // List of branch addresses
     float rating;                           // Restaurant rating
     map<string, vector<MenuItem>> categorizedMenu; // Menu categorized by type (e.g., "Burgers", "Pizzas")
+    const RatingStats *liveRatings = nullptr; // Customer ratings blended into the rating (null if not attached)
 
 public:
     // Constructor to initialize a Restaurant object
     Restaurant(string n, vector<string> b, vector<string> a, float r)
         : name(n), branches(b), addresses(a), rating(r) {}
 
+    // Virtual destructor so restaurants can be deleted through a base pointer
+    virtual ~Restaurant() {}
+
     // Virtual function to display the restaurant's menu
     // Marked virtual to allow derived classes to override it
-    virtual void showMenu() const
+    // currentPrices, if given, holds the current price of each item in menu order
+    virtual void showMenu(const double *currentPrices = nullptr) const
     {
+        size_t index = 0; // Position of the item in menu order
         for (const auto &category : categorizedMenu) // Iterate through each category in the menu map
         {
             cout << "  " << category.first << ":\n"; // Print the category name
             for (const auto &item : category.second) // Iterate through each item in the current category
             {
-                item.show(); // Display the menu item
+                if (currentPrices)
+                    item.show(currentPrices[index]); // Display the menu item at its current price
+                else
+                    item.show(); // Display the menu item
+                index++;
             }
         }
     }
 
     // Virtual function to display detailed information about the restaurant
-    virtual void showDetails() const
+    virtual void showDetails(const double *currentPrices = nullptr) const
     {
         cout << "\n" << string(50, '=') << "\n";
-        cout << "  " << name << " (Rating: " << rating << "/5)" << "\n";
+        cout << "  " << name << " (Rating: " << getRating() << "/5)" << "\n";
         cout << string(50, '=') << "\n";
         cout << " Branches:\n";
         for (size_t i = 0; i < branches.size(); i++) // Iterate through branches and their addresses
@@ -104,16 +693,20 @@ public:
             cout << "   • " << name << " " << branches[i] << " - " << addresses[i] << endl;
         }
         cout << "\n Menu:\n";
-        showMenu(); // Display the menu
+        showMenu(currentPrices); // Display the menu
         cout << string(50, '=') << "\n";
     }
 
     // Virtual getter functions for restaurant properties
     virtual string getName() const { return name; }
-    virtual float getRating() const { return rating; }
+    // The rating includes customer ratings once they are attached; reading it never blocks
+    virtual float getRating() const { return liveRatings ? liveRatings->snapshot().blendedWith(rating) : rating; }
     virtual vector<string> getAddresses() const { return addresses; }
     virtual vector<string> getBranches() const { return branches; }
 
+    // Attaches the aggregate of customer ratings for this restaurant
+    void attachRatings(const RatingStats *stats) { liveRatings = stats; }
+
     // Virtual function to check if the restaurant is currently open (between 12 PM and 11 PM)
     virtual bool isOpenNow() const
     {
@@ -214,152 +807,2819 @@ public:
             MenuItem("Ribeye Steak", 1400),
             MenuItem("T-Bone Steak", 1600)};
     }
-};
+};
+
+// -------------------- Catalog Snapshot --------------------
+// The catalog is stored on disk as a flat binary image: a header, fixed-size
+// tables of restaurants, branches, categories and items, and a pool of
+// null-terminated strings that the tables point into. Start-up maps (or, off
+// POSIX, reads) the file in one call and uses it in place without parsing.
+// The image is generated from the built-in restaurant classes the first time
+// a build runs, and again whenever the build changes.
+
+class CatalogSnapshot
+{
+    static constexpr uint32_t formatVersion = 1;
+
+    struct Header
+    {
+        char magic[8];            // "CHEFSNAP"
+        uint32_t version;         // formatVersion
+        uint32_t restaurantCount; // Entries in the restaurant table
+        uint32_t branchCount;     // Entries in the branch table
+        uint32_t categoryCount;   // Entries in the category table
+        uint32_t itemCount;       // Entries in the item table
+        uint32_t stringBytes;     // Size of the string pool
+        uint64_t buildId;         // Identifies the build that wrote the image
+    };
+
+    struct RestaurantRecord
+    {
+        uint32_t name;          // String pool offset
+        float rating;           // Restaurant rating
+        uint32_t firstBranch;   // Index into the branch table
+        uint32_t branchCount;
+        uint32_t firstCategory; // Index into the category table
+        uint32_t categoryCount;
+    };
+
+    struct BranchRecord
+    {
+        uint32_t name;    // String pool offset of the branch name
+        uint32_t address; // String pool offset of the address
+    };
+
+    struct CategoryRecord
+    {
+        uint32_t name;      // String pool offset
+        uint32_t firstItem; // Index into the item table
+        uint32_t itemCount;
+        uint32_t padding;
+    };
+
+    struct ItemRecord
+    {
+        double price;  // Item price
+        uint32_t name; // String pool offset
+        uint32_t padding;
+    };
+
+    const char *data = nullptr; // Start of the image
+    size_t size = 0;            // Size of the image
+    vector<char> buffer;        // Holds the image when it was read rather than mapped
+    bool mapped = false;        // True if data points at a memory mapping
+
+    const Header &header() const { return *reinterpret_cast<const Header *>(data); }
+
+    // Offsets of the tables; each one is 8-byte aligned
+    static size_t align(size_t offset) { return (offset + 7) & ~size_t(7); }
+    size_t restaurantsAt() const { return align(sizeof(Header)); }
+    size_t branchesAt() const { return align(restaurantsAt() + header().restaurantCount * sizeof(RestaurantRecord)); }
+    size_t categoriesAt() const { return align(branchesAt() + header().branchCount * sizeof(BranchRecord)); }
+    size_t itemsAt() const { return align(categoriesAt() + header().categoryCount * sizeof(CategoryRecord)); }
+    size_t stringsAt() const { return align(itemsAt() + header().itemCount * sizeof(ItemRecord)); }
+
+    const RestaurantRecord &restaurant(size_t r) const { return reinterpret_cast<const RestaurantRecord *>(data + restaurantsAt())[r]; }
+    const BranchRecord &branch(size_t r, size_t b) const { return reinterpret_cast<const BranchRecord *>(data + branchesAt())[restaurant(r).firstBranch + b]; }
+    const CategoryRecord &category(size_t r, size_t c) const { return reinterpret_cast<const CategoryRecord *>(data + categoriesAt())[restaurant(r).firstCategory + c]; }
+    const ItemRecord &item(size_t r, size_t c, size_t i) const { return reinterpret_cast<const ItemRecord *>(data + itemsAt())[category(r, c).firstItem + i]; }
+    string_view text(uint32_t offset) const { return string_view(data + stringsAt() + offset); }
+
+    // Identifies this build, so an image written by another build is regenerated
+    static uint64_t currentBuildId()
+    {
+        uint64_t hash = 1469598103934665603ull;
+        for (char c : string(__DATE__ " " __TIME__))
+            hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+        return hash ^ formatVersion;
+    }
+
+    // Checks the header and that every table and string lies inside the image
+    bool valid() const
+    {
+        if (size < sizeof(Header) || memcmp(header().magic, "CHEFSNAP", 8) != 0 ||
+            header().version != formatVersion || header().buildId != currentBuildId())
+            return false;
+        if (stringsAt() + header().stringBytes != size || header().stringBytes == 0 || data[size - 1] != '\0')
+            return false;
+        auto inPool = [this](uint32_t offset) { return offset < header().stringBytes; };
+        for (size_t r = 0; r < header().restaurantCount; r++)
+        {
+            const RestaurantRecord &record = restaurant(r);
+            // Sums in 64 bits, so a huge first index cannot wrap around and pass
+            if (!inPool(record.name) || uint64_t(record.firstBranch) + record.branchCount > header().branchCount ||
+                uint64_t(record.firstCategory) + record.categoryCount > header().categoryCount)
+                return false;
+            for (size_t b = 0; b < record.branchCount; b++)
+            {
+                if (!inPool(branch(r, b).name) || !inPool(branch(r, b).address))
+                    return false;
+            }
+            for (size_t c = 0; c < record.categoryCount; c++)
+            {
+                if (!inPool(category(r, c).name) || uint64_t(category(r, c).firstItem) + category(r, c).itemCount > header().itemCount)
+                    return false;
+                for (size_t i = 0; i < category(r, c).itemCount; i++)
+                {
+                    if (!inPool(item(r, c, i).name))
+                        return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Releases the current image
+    void close()
+    {
+#ifdef __unix__
+        if (mapped)
+            munmap(const_cast<char *>(data), size);
+#endif
+        buffer.clear();
+        data = nullptr;
+        size = 0;
+        mapped = false;
+    }
+
+public:
+    CatalogSnapshot() = default;
+    CatalogSnapshot(const CatalogSnapshot &) = delete;
+    CatalogSnapshot &operator=(const CatalogSnapshot &) = delete;
+
+    // Maps an image into memory; returns false if it is missing, from another build or damaged
+    bool open(const string &path)
+    {
+        close();
+#ifdef __unix__
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0)
+        {
+            void *image = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (image != MAP_FAILED)
+            {
+                data = static_cast<const char *>(image);
+                size = info.st_size;
+                mapped = true;
+            }
+        }
+        ::close(fd);
+#else
+        ifstream in(path, ios::binary | ios::ate);
+        if (in)
+        {
+            buffer.resize(static_cast<size_t>(in.tellg()));
+            in.seekg(0);
+            in.read(buffer.data(), buffer.size()); // One read for the whole image
+            data = buffer.data();
+            size = buffer.size();
+        }
+#endif
+        if (data == nullptr || !valid())
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    // Writes an image of the given restaurants (via a temp file, so readers never see half of it)
+    static void write(const string &path, const vector<Restaurant *> &restaurants)
+    {
+        vector<RestaurantRecord> restaurantTable;
+        vector<BranchRecord> branchTable;
+        vector<CategoryRecord> categoryTable;
+        vector<ItemRecord> itemTable;
+        string strings;
+        auto intern = [&strings](const string &s)
+        {
+            uint32_t offset = static_cast<uint32_t>(strings.size());
+            strings += s;
+            strings.push_back('\0');
+            return offset;
+        };
+
+        for (auto r : restaurants)
+        {
+            vector<string> branches = r->getBranches();
+            vector<string> addresses = r->getAddresses();
+            auto menu = r->getCategorizedMenu();
+            restaurantTable.push_back({intern(r->getName()), r->getRating(), static_cast<uint32_t>(branchTable.size()),
+                                       static_cast<uint32_t>(branches.size()), static_cast<uint32_t>(categoryTable.size()),
+                                       static_cast<uint32_t>(menu.size())});
+            for (size_t i = 0; i < branches.size(); i++)
+                branchTable.push_back({intern(branches[i]), intern(addresses[i])});
+            for (const auto &category : menu) // Map order, the same order showMenu() uses
+            {
+                categoryTable.push_back({intern(category.first), static_cast<uint32_t>(itemTable.size()),
+                                         static_cast<uint32_t>(category.second.size()), 0});
+                for (const auto &item : category.second)
+                    itemTable.push_back({item.getPrice(), intern(item.getName()), 0});
+            }
+        }
+
+        Header head = {{'C', 'H', 'E', 'F', 'S', 'N', 'A', 'P'}, formatVersion,
+                       static_cast<uint32_t>(restaurantTable.size()), static_cast<uint32_t>(branchTable.size()),
+                       static_cast<uint32_t>(categoryTable.size()), static_cast<uint32_t>(itemTable.size()),
+                       static_cast<uint32_t>(strings.size()), currentBuildId()};
+        string image(reinterpret_cast<const char *>(&head), sizeof(head));
+        auto appendTable = [&image](const void *table, size_t bytes)
+        {
+            image.resize(align(image.size()), '\0');
+            image.append(static_cast<const char *>(table), bytes);
+        };
+        appendTable(restaurantTable.data(), restaurantTable.size() * sizeof(RestaurantRecord));
+        appendTable(branchTable.data(), branchTable.size() * sizeof(BranchRecord));
+        appendTable(categoryTable.data(), categoryTable.size() * sizeof(CategoryRecord));
+        appendTable(itemTable.data(), itemTable.size() * sizeof(ItemRecord));
+        appendTable(strings.data(), strings.size());
+
+#ifdef __unix__
+        // A fresh, exclusively created temp file, so a planted file or symlink is never written through
+        string temp = path + ".XXXXXX";
+        int fd = mkstemp(&temp[0]);
+        if (fd < 0)
+            throw runtime_error("could not create a temp file for " + path);
+        size_t written = 0;
+        while (written < image.size())
+        {
+            ssize_t n = ::write(fd, image.data() + written, image.size() - written);
+            if (n <= 0)
+                break;
+            written += static_cast<size_t>(n);
+        }
+        fchmod(fd, 0644);
+        ::close(fd);
+        if (written != image.size())
+        {
+            ::unlink(temp.c_str());
+            throw runtime_error("could not write " + temp);
+        }
+#else
+        string temp = path + ".tmp";
+        {
+            ofstream out(temp, ios::binary | ios::trunc);
+            if (!out.write(image.data(), image.size()) || !out.flush())
+                throw runtime_error("could not write " + temp);
+        }
+#endif
+        error_code failed;
+        filesystem::rename(temp, path, failed);
+        if (failed)
+        {
+            filesystem::remove(temp, failed);
+            throw runtime_error("could not replace " + path);
+        }
+    }
+
+    // Read-only views of the image
+    size_t restaurantCount() const { return header().restaurantCount; }
+    string_view restaurantName(size_t r) const { return text(restaurant(r).name); }
+    float restaurantRating(size_t r) const { return restaurant(r).rating; }
+    size_t branchCount(size_t r) const { return restaurant(r).branchCount; }
+    string_view branchName(size_t r, size_t b) const { return text(branch(r, b).name); }
+    string_view branchAddress(size_t r, size_t b) const { return text(branch(r, b).address); }
+    size_t categoryCount(size_t r) const { return restaurant(r).categoryCount; }
+    string_view categoryName(size_t r, size_t c) const { return text(category(r, c).name); }
+    size_t itemCount(size_t r, size_t c) const { return category(r, c).itemCount; }
+    string_view itemName(size_t r, size_t c, size_t i) const { return text(item(r, c, i).name); }
+    double itemPrice(size_t r, size_t c, size_t i) const { return item(r, c, i).price; }
+
+    ~CatalogSnapshot() { close(); }
+};
+
+// A restaurant materialized from the catalog snapshot on first use
+class SnapshotRestaurant : public Restaurant
+{
+public:
+    // Constructor copies one restaurant's records out of the snapshot
+    SnapshotRestaurant(const CatalogSnapshot &snapshot, size_t r)
+        : Restaurant(string(snapshot.restaurantName(r)), {}, {}, snapshot.restaurantRating(r))
+    {
+        for (size_t b = 0; b < snapshot.branchCount(r); b++)
+        {
+            branches.emplace_back(snapshot.branchName(r, b));
+            addresses.emplace_back(snapshot.branchAddress(r, b));
+        }
+        for (size_t c = 0; c < snapshot.categoryCount(r); c++)
+        {
+            auto &items = categorizedMenu[string(snapshot.categoryName(r, c))];
+            for (size_t i = 0; i < snapshot.itemCount(r, c); i++)
+                items.emplace_back(string(snapshot.itemName(r, c, i)), snapshot.itemPrice(r, c, i));
+        }
+    }
+};
+
+// -------------------- Catalog Shards --------------------
+// The catalog is partitioned by city. Each shard keeps its own branch and menu
+// indexes and answers queries on its own worker thread, so a single-city query
+// touches one shard and a global query fans out to every shard in parallel.
+
+// A restaurant branch located in a shard's city
+struct BranchEntry
+{
+    size_t restaurant;     // Index of the restaurant in ChefBot's list (used to merge results)
+    size_t order;          // Position of the branch within its restaurant
+    string restaurantName; // Name of the restaurant
+    string branch;         // Branch name
+    string address;        // Branch address
+    string lowerAddress;   // Lowercase address for case-insensitive matching
+};
+
+// A menu item indexed for recommendation queries
+struct MenuEntry
+{
+    size_t restaurant;     // Index of the restaurant in ChefBot's list (used to merge results)
+    size_t order;          // Position of the item within its restaurant's menu
+    string restaurantName; // Name of the restaurant
+    string category;       // Menu category the item belongs to
+    string itemName;       // Name of the item
+    string lowerName;      // Lowercase name for keyword matching
+    double price;          // Price of the item
+};
+
+// Extracts the city from an address (its last word, e.g. "DHA Lahore" -> "Lahore")
+string cityOf(const string &address)
+{
+    size_t space = address.find_last_of(' ');
+    return space == string::npos ? address : address.substr(space + 1);
+}
+
+// Runs a shard's queries on a dedicated thread
+class ShardWorker
+{
+    mutex queueLock;                // Guards tasks and stopping
+    condition_variable ready;       // Signalled when a task is queued or the worker stops
+    queue<function<void()>> tasks;  // Pending tasks
+    bool stopping = false;          // Set when the worker should exit
+    thread worker;                  // The worker thread (declared last so it starts after the members above)
+
+    // Worker loop: runs queued tasks until asked to stop
+    void run()
+    {
+        while (true)
+        {
+            function<void()> task;
+            {
+                unique_lock<mutex> guard(queueLock);
+                ready.wait(guard, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty())
+                    return; // Stopping and nothing left to do
+                task = move(tasks.front());
+                tasks.pop();
+            }
+            task();
+        }
+    }
+
+public:
+    // Starts the worker and pins it to the given core where the platform allows it
+    explicit ShardWorker(unsigned core) : worker(&ShardWorker::run, this)
+    {
+#ifdef __linux__
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(core, &cpus);
+        pthread_setaffinity_np(worker.native_handle(), sizeof(cpus), &cpus); // Best effort, ignore failure
+#else
+        (void)core;
+#endif
+    }
+
+    // Queues a task and returns a future for its result
+    template <typename Task>
+    auto submit(Task task) -> future<decltype(task())>
+    {
+        auto job = make_shared<packaged_task<decltype(task())()>>(move(task));
+        future<decltype(task())> result = job->get_future();
+        {
+            lock_guard<mutex> guard(queueLock);
+            tasks.push([job] { (*job)(); });
+        }
+        ready.notify_one();
+        return result;
+    }
+
+    // Finishes queued tasks and joins the worker thread
+    ~ShardWorker()
+    {
+        {
+            lock_guard<mutex> guard(queueLock);
+            stopping = true;
+        }
+        ready.notify_all();
+        worker.join();
+    }
+};
+
+// One city's slice of the catalog
+class CatalogShard
+{
+    string city;                // City served by this shard
+    vector<BranchEntry> branches; // Branches located in the city
+    vector<MenuEntry> menu;     // Items of restaurants homed in the city, sorted by price
+    unique_ptr<ShardWorker> worker; // Thread that answers this shard's queries
+
+public:
+    // Constructor to initialize an empty shard for a city
+    explicit CatalogShard(string city) : city(city) {}
+
+    // Adds a branch to the shard's index (only before start())
+    void addBranch(BranchEntry entry) { branches.push_back(move(entry)); }
+    // Adds a menu item to the shard's index (only before start())
+    void addItem(MenuEntry entry) { menu.push_back(move(entry)); }
+
+    // Finalizes the indexes and starts the shard's worker thread
+    void start(unsigned core)
+    {
+        stable_sort(menu.begin(), menu.end(), [](const MenuEntry &a, const MenuEntry &b)
+                    { return a.price < b.price; });
+        worker = make_unique<ShardWorker>(core);
+    }
+
+    string getCity() const { return city; }
+
+    // Finds branches whose address contains the lowercase query
+    future<vector<BranchEntry>> findBranches(string lowerQuery)
+    {
+        return worker->submit([this, lowerQuery]
+        {
+            vector<BranchEntry> found;
+            for (const auto &entry : branches)
+            {
+                if (entry.lowerAddress.find(lowerQuery) != string::npos)
+                    found.push_back(entry);
+            }
+            return found;
+        });
+    }
+
+    // Finds items priced at or under maxPrice whose name contains the lowercase keyword
+    future<vector<MenuEntry>> findItems(string lowerKeyword, double maxPrice)
+    {
+        return worker->submit([this, lowerKeyword, maxPrice]
+        {
+            vector<MenuEntry> found;
+            auto end = upper_bound(menu.begin(), menu.end(), maxPrice, [](double price, const MenuEntry &entry)
+                                   { return price < entry.price; });
+            for (auto it = menu.begin(); it != end; ++it)
+            {
+                if (lowerKeyword.empty() || it->lowerName.find(lowerKeyword) != string::npos)
+                    found.push_back(*it);
+            }
+            return found;
+        });
+    }
+};
+
+// The restaurant catalog, partitioned into one shard per city
+class Catalog
+{
+    vector<unique_ptr<CatalogShard>> shards; // All shards, in order of first appearance
+    map<string, size_t> shardByCity;         // Lowercase city -> shard index
+
+    // Returns the shard for a city, creating it if needed
+    CatalogShard &shardFor(const string &city)
+    {
+        auto it = shardByCity.find(toLower(city));
+        if (it != shardByCity.end())
+            return *shards[it->second];
+        shardByCity[toLower(city)] = shards.size();
+        shards.push_back(make_unique<CatalogShard>(city));
+        return *shards.back();
+    }
+
+    // Sorts merged results back into catalog order (restaurant, then position)
+    template <typename Entry>
+    static void sortByCatalogOrder(vector<Entry> &entries)
+    {
+        sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b)
+             { return a.restaurant != b.restaurant ? a.restaurant < b.restaurant : a.order < b.order; });
+    }
+
+public:
+    // Builds every shard's indexes from the restaurants and starts the shard workers.
+    // Branches go to the shard of their city; a restaurant's menu is indexed by the
+    // shard of its first branch so that global queries see each item exactly once.
+    void build(const CatalogSnapshot &snapshot)
+    {
+        for (size_t r = 0; r < snapshot.restaurantCount(); r++)
+        {
+            string name(snapshot.restaurantName(r));
+            for (size_t i = 0; i < snapshot.branchCount(r); i++)
+            {
+                string address(snapshot.branchAddress(r, i));
+                shardFor(cityOf(address)).addBranch({r, i, name, string(snapshot.branchName(r, i)), address, toLower(address)});
+            }
+
+            if (snapshot.branchCount(r) == 0)
+                continue;
+            CatalogShard &home = shardFor(cityOf(string(snapshot.branchAddress(r, 0))));
+            size_t order = 0;
+            for (size_t c = 0; c < snapshot.categoryCount(r); c++)
+            {
+                for (size_t i = 0; i < snapshot.itemCount(r, c); i++)
+                {
+                    string item(snapshot.itemName(r, c, i));
+                    home.addItem({r, order++, name, string(snapshot.categoryName(r, c)), item, toLower(item), snapshot.itemPrice(r, c, i)});
+                }
+            }
+        }
+
+        unsigned cores = max(1u, thread::hardware_concurrency());
+        for (size_t i = 0; i < shards.size(); i++)
+            shards[i]->start(static_cast<unsigned>(i % cores));
+    }
+
+    // Lists the known cities
+    vector<string> getCities() const
+    {
+        vector<string> cities;
+        for (const auto &shard : shards)
+            cities.push_back(shard->getCity());
+        return cities;
+    }
+
+    // Finds branches for a city. A known city is answered by its own shard only;
+    // anything else (e.g. a sector like "G-10") is fanned out to every shard.
+    vector<BranchEntry> findBranches(const string &query)
+    {
+        string lowerQuery = toLower(query);
+        vector<future<vector<BranchEntry>>> pending;
+        auto owner = shardByCity.find(lowerQuery);
+        if (owner != shardByCity.end())
+            pending.push_back(shards[owner->second]->findBranches(lowerQuery));
+        else
+        {
+            for (auto &shard : shards)
+                pending.push_back(shard->findBranches(lowerQuery));
+        }
+
+        vector<BranchEntry> found;
+        for (auto &result : pending)
+        {
+            vector<BranchEntry> part = result.get();
+            found.insert(found.end(), part.begin(), part.end());
+        }
+        sortByCatalogOrder(found);
+        return found;
+    }
+
+    // Finds items at or under maxPrice matching a keyword, fanned out to every shard
+    vector<MenuEntry> findItems(const string &keyword, double maxPrice)
+    {
+        vector<future<vector<MenuEntry>>> pending;
+        for (auto &shard : shards)
+            pending.push_back(shard->findItems(toLower(keyword), maxPrice));
+
+        vector<MenuEntry> found;
+        for (auto &result : pending)
+        {
+            vector<MenuEntry> part = result.get();
+            found.insert(found.end(), part.begin(), part.end());
+        }
+        sortByCatalogOrder(found);
+        return found;
+    }
+};
+
+// -------------------- Key-Value Store --------------------
+// A small log-structured key-value store that keeps user profiles, saved carts
+// and order indexes on local disk. Writes are appended to a write-ahead log and
+// applied to an in-memory memtable; a full memtable is flushed to a sorted,
+// immutable segment file, and a background thread merges runs of similar-sized
+// segments (size-tiered) so that lookups stay a handful of binary searches and
+// each record is rewritten about once per tier rather than on every merge.
+// A merged segment's file name records the range of segments it replaces, so a
+// crash before the inputs are deleted cannot bring their older values back.
+
+// Forces a file or directory to disk so a crash cannot lose or tear it
+void syncToDisk(const string &path)
+{
+#ifdef __unix__
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd >= 0)
+    {
+        ::fsync(fd);
+        ::close(fd);
+    }
+#else
+    (void)path;
+#endif
+}
+
+class KeyValueStore
+{
+    // Location of one record's value inside a segment file
+    struct SegmentEntry
+    {
+        string key;       // Record key
+        streamoff offset; // File offset of the value
+        uint32_t length;  // Length of the value
+        bool erased;      // True for a deletion marker
+    };
+
+    // An immutable sorted segment file and its in-memory key index
+    struct Segment
+    {
+        uint64_t first;             // Oldest segment number merged into this one
+        uint64_t number;            // Segment number (higher is newer)
+        string path;                // Segment file path
+        vector<SegmentEntry> index; // Entries sorted by key
+    };
+
+    // A memtable value; erased entries shadow older segments until compaction
+    struct Slot
+    {
+        bool erased;
+        string value;
+    };
+
+    static constexpr size_t flushThreshold = 256;  // Memtable entries that trigger a flush
+    static constexpr size_t compactionTrigger = 4; // Adjacent segments of one size tier that trigger a compaction
+
+    string directory;                          // Directory holding the log and segments
+    mutable mutex storeLock;                   // Guards everything below
+    condition_variable compactionNeeded;       // Wakes the compaction thread
+    map<string, Slot> memtable;                // Writes not yet flushed to a segment
+    vector<shared_ptr<Segment>> segments;      // Segments from oldest to newest
+    uint64_t nextSegment = 1;                  // Number for the next segment file
+    bool stopping = false;                     // Set when the compaction thread should exit
+    thread compactor;                          // Background compaction thread (declared last)
+
+    // Appends a little-endian 32-bit integer
+    static void putU32(string &out, uint32_t value)
+    {
+        for (int i = 0; i < 4; i++)
+            out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+
+    // Reads a little-endian 32-bit integer, returning false at end of file
+    static bool getU32(istream &in, uint32_t &value)
+    {
+        unsigned char bytes[4];
+        if (!in.read(reinterpret_cast<char *>(bytes), 4))
+            return false;
+        value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+        return true;
+    }
+
+    // FNV-1a checksum over a record's contents, used to detect torn writes
+    static uint32_t checksum(char op, const string &key, const string &value)
+    {
+        uint32_t hash = 2166136261u;
+        auto mix = [&hash](char c) { hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u; };
+        mix(op);
+        for (char c : key)
+            mix(c);
+        for (char c : value)
+            mix(c);
+        return hash;
+    }
+
+    // Encodes a record as [op][key length][value length][key][value][checksum]
+    static string encodeRecord(char op, const string &key, const string &value)
+    {
+        string out(1, op);
+        putU32(out, static_cast<uint32_t>(key.size()));
+        putU32(out, static_cast<uint32_t>(value.size()));
+        out += key;
+        out += value;
+        putU32(out, checksum(op, key, value));
+        return out;
+    }
+
+    // Decodes the next record; returns false at end of file or on a torn record
+    static bool decodeRecord(istream &in, char &op, string &key, string &value, streamoff &valueOffset)
+    {
+        uint32_t keyLength, valueLength, sum;
+        if (!in.get(op) || (op != 'P' && op != 'D') || !getU32(in, keyLength) || !getU32(in, valueLength))
+            return false;
+        key.resize(keyLength);
+        value.resize(valueLength);
+        if (!in.read(&key[0], keyLength))
+            return false;
+        valueOffset = in.tellg();
+        if (!in.read(&value[0], valueLength) || !getU32(in, sum))
+            return false;
+        return sum == checksum(op, key, value);
+    }
+
+    string logPath() const { return directory + "/wal.log"; }
+
+    // Path of a flushed segment ("seg-<number>.dat") or a merged one ("seg-<first>-<number>.dat")
+    string segmentPath(uint64_t first, uint64_t number) const
+    {
+        ostringstream name;
+        name << directory << "/seg-" << setfill('0');
+        if (first != number)
+            name << setw(8) << first << "-";
+        name << setw(8) << number << ".dat";
+        return name.str();
+    }
+
+    // Reads the numbers out of a segment file name; returns false for other files
+    static bool parseSegmentName(const string &name, uint64_t &first, uint64_t &number)
+    {
+        if (name.size() <= 8 || name.rfind("seg-", 0) != 0 || name.compare(name.size() - 4, 4, ".dat") != 0)
+            return false;
+        string numbers = name.substr(4, name.size() - 8);
+        size_t dash = numbers.find('-');
+        try
+        {
+            first = stoull(numbers.substr(0, dash));
+            number = (dash == string::npos) ? first : stoull(numbers.substr(dash + 1));
+        }
+        catch (const exception &)
+        {
+            return false;
+        }
+        return first <= number;
+    }
+
+    // Loads a segment file's key index
+    shared_ptr<Segment> loadSegment(uint64_t first, uint64_t number, const string &path) const
+    {
+        auto segment = make_shared<Segment>();
+        segment->first = first;
+        segment->number = number;
+        segment->path = path;
+        ifstream in(path, ios::binary);
+        char op;
+        string key, value;
+        streamoff offset;
+        while (decodeRecord(in, op, key, value, offset))
+            segment->index.push_back({key, offset, static_cast<uint32_t>(value.size()), op == 'D'});
+        return segment;
+    }
+
+    // Writes sorted records to a new segment file atomically (temp file + rename)
+    shared_ptr<Segment> writeSegment(uint64_t first, uint64_t number, const vector<pair<string, Slot>> &records) const
+    {
+        string path = segmentPath(first, number);
+        string temp = path + ".tmp";
+        try
+        {
+            {
+                ofstream out(temp, ios::binary | ios::trunc);
+                for (const auto &record : records)
+                    out << encodeRecord(record.second.erased ? 'D' : 'P', record.first, record.second.value);
+                if (!out.flush())
+                    throw runtime_error("could not write segment " + temp);
+            }
+            syncToDisk(temp);
+            filesystem::rename(temp, path);
+        }
+        catch (const exception &)
+        {
+            error_code ignored;
+            filesystem::remove(temp, ignored);
+            throw;
+        }
+        syncToDisk(directory);
+        return loadSegment(first, number, path);
+    }
+
+    // Reads a value from a segment file
+    static string readValue(const Segment &segment, const SegmentEntry &entry)
+    {
+        string value(entry.length, '\0');
+        ifstream in(segment.path, ios::binary);
+        in.seekg(entry.offset);
+        in.read(&value[0], entry.length);
+        return value;
+    }
+
+    // Finds a key in a segment's index, or returns nullptr
+    static const SegmentEntry *findInSegment(const Segment &segment, const string &key)
+    {
+        auto it = lower_bound(segment.index.begin(), segment.index.end(), key,
+                              [](const SegmentEntry &entry, const string &k) { return entry.key < k; });
+        return (it != segment.index.end() && it->key == key) ? &*it : nullptr;
+    }
+
+    // Appends encoded records to the write-ahead log and syncs it
+    void appendToLog(const string &records)
+    {
+        {
+            ofstream log(logPath(), ios::binary | ios::app);
+            if (!(log << records) || !log.flush())
+                throw runtime_error("could not write to " + logPath());
+        }
+        syncToDisk(logPath());
+    }
+
+    // Empties the log and syncs it, so the next append starts at offset 0
+    void resetLog()
+    {
+        ofstream(logPath(), ios::binary | ios::trunc);
+        syncToDisk(logPath());
+    }
+
+    // Flushes the memtable to a new segment and starts a fresh log (storeLock held)
+    void flushLocked()
+    {
+        if (memtable.empty())
+            return;
+        vector<pair<string, Slot>> records(memtable.begin(), memtable.end());
+        segments.push_back(writeSegment(nextSegment, nextSegment, records));
+        nextSegment++;
+        memtable.clear();
+        resetLog(); // The flushed records are now durable in the segment
+        if (segments.size() >= compactionTrigger)
+            compactionNeeded.notify_one();
+    }
+
+    // Applies a write to the log and memtable
+    void write(char op, const string &key, const string &value)
+    {
+        lock_guard<mutex> guard(storeLock);
+        appendToLog(encodeRecord(op, key, value));
+        memtable[key] = {op == 'D', value};
+        if (memtable.size() >= flushThreshold)
+            flushLocked();
+    }
+
+    // Size tier of a segment: tier t holds about flushThreshold * compactionTrigger^t entries
+    static size_t tierOf(const Segment &segment)
+    {
+        size_t tier = 0;
+        for (size_t n = segment.index.size() / flushThreshold; n >= compactionTrigger; n /= compactionTrigger)
+            tier++;
+        return tier;
+    }
+
+    // Picks the next run of adjacent same-tier segments to merge, as a range of
+    // indexes into segments (empty if no tier has enough segments yet)
+    pair<size_t, size_t> pickCompaction() const
+    {
+        size_t begin = 0;
+        for (size_t i = 1; i <= segments.size(); i++)
+        {
+            if (i == segments.size() || tierOf(*segments[i]) != tierOf(*segments[begin]))
+            {
+                if (i - begin >= compactionTrigger)
+                    return {begin, i};
+                begin = i;
+            }
+        }
+        return {0, 0};
+    }
+
+    // Merges segments (newest value wins) and writes the result as one segment.
+    // Deletion markers are kept unless nothing older than the inputs remains.
+    shared_ptr<Segment> mergeSegments(const vector<shared_ptr<Segment>> &inputs, bool includesOldest) const
+    {
+        map<string, Slot> merged;
+        for (auto it = inputs.rbegin(); it != inputs.rend(); ++it) // Newest first, so newer values win
+        {
+            for (const auto &entry : (*it)->index)
+            {
+                if (merged.count(entry.key) == 0)
+                    merged[entry.key] = {entry.erased, entry.erased ? "" : readValue(**it, entry)};
+            }
+        }
+        vector<pair<string, Slot>> records;
+        for (auto &record : merged)
+        {
+            if (!record.second.erased || !includesOldest)
+                records.emplace_back(record.first, move(record.second));
+        }
+        return writeSegment(inputs.front()->first, inputs.back()->number, records);
+    }
+
+    // Background loop: merges segments whenever enough pile up. The merged segment is
+    // written first and only then swapped in, so a failed write loses nothing.
+    void compactLoop()
+    {
+        unique_lock<mutex> guard(storeLock);
+        size_t failedAt = 0; // Segment count when the last compaction failed (0 if none)
+        while (true)
+        {
+            pair<size_t, size_t> run;
+            compactionNeeded.wait(guard, [&] {
+                if (stopping)
+                    return true;
+                if (segments.size() == failedAt) // Retry only once another flush has happened
+                    return false;
+                run = pickCompaction();
+                return run.second > run.first;
+            });
+            if (stopping)
+                return;
+
+            // Only this thread removes segments, so the inputs stay valid while unlocked
+            vector<shared_ptr<Segment>> inputs(segments.begin() + run.first, segments.begin() + run.second);
+            guard.unlock();
+
+            shared_ptr<Segment> output;
+            try
+            {
+                output = mergeSegments(inputs, run.first == 0);
+            }
+            catch (const exception &e)
+            {
+                guard.lock();
+                failedAt = segments.size();
+                cout << "\n Warning: Store compaction failed (will retry after the next flush): " << e.what() << "\n";
+                continue;
+            }
+
+            guard.lock();
+            failedAt = 0;
+            segments.erase(segments.begin() + run.first, segments.begin() + run.second);
+            segments.insert(segments.begin() + run.first, output);
+            for (const auto &input : inputs) // The output's name covers the inputs, so leftovers are dropped on open
+            {
+                error_code ignored;
+                filesystem::remove(input->path, ignored);
+            }
+        }
+    }
+
+public:
+    // Opens (or creates) a store in the given directory, recovering from the log
+    explicit KeyValueStore(string dir) : directory(dir)
+    {
+        filesystem::create_directories(directory);
+
+        struct SegmentFile
+        {
+            uint64_t first, number;
+            string path;
+        };
+        vector<SegmentFile> found;
+        for (const auto &file : filesystem::directory_iterator(directory))
+        {
+            string name = file.path().filename().string();
+            uint64_t first, number;
+            if (file.path().extension() == ".tmp")
+                filesystem::remove(file.path()); // Unfinished segment from an interrupted write
+            else if (parseSegmentName(name, first, number))
+                found.push_back({first, number, file.path().string()});
+        }
+        sort(found.begin(), found.end(), [](const SegmentFile &a, const SegmentFile &b) { return a.number < b.number; });
+        for (const auto &segment : found)
+        {
+            bool covered = false; // Input of a merge that finished before a crash
+            for (const auto &other : found)
+            {
+                if (&other != &segment && other.first <= segment.first && segment.number <= other.number)
+                    covered = true;
+            }
+            if (covered)
+            {
+                filesystem::remove(segment.path);
+                continue;
+            }
+            segments.push_back(loadSegment(segment.first, segment.number, segment.path));
+            nextSegment = max(nextSegment, segment.number + 1);
+        }
+
+        // Replay the log up to the first torn record, then fold it into a segment
+        ifstream log(logPath(), ios::binary);
+        char op;
+        string key, value;
+        streamoff offset;
+        while (decodeRecord(log, op, key, value, offset))
+            memtable[key] = {op == 'D', value};
+        log.close();
+        if (memtable.empty())
+            resetLog(); // Nothing to flush, but a torn tail would hide every later append
+        else
+            flushLocked();
+
+        compactor = thread(&KeyValueStore::compactLoop, this);
+    }
+
+    // Stores a value
+    void put(const string &key, const string &value) { write('P', key, value); }
+
+    // Removes a key
+    void erase(const string &key) { write('D', key, ""); }
+
+    // Stores several values with a single log append and sync (group commit).
+    // Records are logged in order, so a crash keeps a prefix of the batch.
+    void putAll(const vector<pair<string, string>> &records)
+    {
+        string batch;
+        for (const auto &record : records)
+            batch += encodeRecord('P', record.first, record.second);
+
+        lock_guard<mutex> guard(storeLock);
+        appendToLog(batch);
+        for (const auto &record : records)
+            memtable[record.first] = {false, record.second};
+        if (memtable.size() >= flushThreshold)
+            flushLocked();
+    }
+
+    // Looks up a key, returning false if it is missing
+    bool get(const string &key, string &value) const
+    {
+        lock_guard<mutex> guard(storeLock);
+        auto slot = memtable.find(key);
+        if (slot != memtable.end())
+        {
+            value = slot->second.value;
+            return !slot->second.erased;
+        }
+        for (auto it = segments.rbegin(); it != segments.rend(); ++it) // Newest segment first
+        {
+            if (const SegmentEntry *entry = findInSegment(**it, key))
+            {
+                if (entry->erased)
+                    return false;
+                value = readValue(**it, *entry);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Returns up to limit entries whose keys start with prefix (non-empty), largest key first
+    vector<pair<string, string>> scanNewest(const string &prefix, size_t limit) const
+    {
+        lock_guard<mutex> guard(storeLock);
+        string bound = prefix;
+        bound.back()++; // Smallest string greater than every key with this prefix
+
+        // Each source is walked backwards from the end of its prefix range
+        auto memBegin = memtable.lower_bound(prefix);
+        auto memEnd = memtable.lower_bound(bound);
+        vector<pair<const SegmentEntry *, const SegmentEntry *>> ranges; // Newest segment first
+        auto byKey = [](const SegmentEntry &entry, const string &k) { return entry.key < k; };
+        for (auto it = segments.rbegin(); it != segments.rend(); ++it)
+        {
+            const auto &index = (*it)->index;
+            auto first = lower_bound(index.begin(), index.end(), prefix, byKey);
+            auto last = lower_bound(first, index.end(), bound, byKey);
+            ranges.emplace_back(index.data() + (first - index.begin()), index.data() + (last - index.begin()));
+        }
+
+        vector<pair<string, string>> results;
+        while (results.size() < limit)
+        {
+            const string *largest = nullptr;
+            if (memEnd != memBegin)
+                largest = &prev(memEnd)->first;
+            for (const auto &range : ranges)
+            {
+                if (range.first != range.second && (largest == nullptr || (range.second - 1)->key > *largest))
+                    largest = &(range.second - 1)->key;
+            }
+            if (largest == nullptr)
+                break;
+
+            // The newest source holding the key decides its value; older copies are skipped
+            string key = *largest;
+            bool decided = false, erased = false;
+            string value;
+            if (memEnd != memBegin && prev(memEnd)->first == key)
+            {
+                --memEnd;
+                decided = true;
+                erased = memEnd->second.erased;
+                value = memEnd->second.value;
+            }
+            for (size_t i = 0; i < ranges.size(); i++)
+            {
+                auto &range = ranges[i];
+                if (range.first == range.second || (range.second - 1)->key != key)
+                    continue;
+                --range.second;
+                if (!decided)
+                {
+                    decided = true;
+                    erased = range.second->erased;
+                    if (!erased)
+                        value = readValue(*segments[segments.size() - 1 - i], *range.second);
+                }
+            }
+            if (!erased)
+                results.emplace_back(key, value);
+        }
+        return results;
+    }
+
+    // Stops the compaction thread; unflushed writes stay safe in the log
+    ~KeyValueStore()
+    {
+        {
+            lock_guard<mutex> guard(storeLock);
+            stopping = true;
+        }
+        compactionNeeded.notify_all();
+        compactor.join();
+    }
+};
+
+// -------------------- Pricing and Promotions --------------------
+// Menu prices live in structure-of-arrays columns (one entry per menu item, in
+// catalog order) and promotions are compiled into per-item columns when they
+// are loaded. Pricing a whole menu is then a few straight passes over
+// contiguous doubles, no matter how many promotions are active. GCC vectorizes
+// every pass at -O3; at -O2 its cheaper cost model leaves them scalar.
+//
+// Promotions are read from promotions.txt, one per line, fields separated by
+// '|' ('*' matches anything; '#' starts a comment):
+//   deal|<restaurant>|<category>|<item>|<percent off>|<from hour>|<to hour>
+//   override|<restaurant>|<branch>|<item>|<price>
+//   bundle|<restaurant>|<category>|<item>|<minimum quantity>|<percent off>
+//   coupon|<code>|<percent off>|<minimum subtotal>
+// Percents are 0-100, hours whole numbers 0-24, prices non-negative and minimum
+// quantities at least 1; a line with any other value is skipped with a warning.
+
+// The price breakdown for one order line
+struct OrderQuote
+{
+    double unitPrice = 0; // Price of one item after deals and branch overrides
+    int quantity = 1;     // Number of items
+    double subtotal = 0;  // unitPrice * quantity
+    double bundleDiscount = 0; // Discount from bundle promotions
+    double couponDiscount = 0; // Discount from the coupon code
+    bool couponAccepted = false; // True if a coupon was given and applied
+    double tax = 0;       // 15% tax on the discounted subtotal
+    double total = 0;     // Amount to pay
+};
+
+class PromotionEngine
+{
+    // A percentage discount on matching items between two hours of the day
+    struct Deal
+    {
+        string description;   // Human-readable summary
+        double percent;       // Fraction taken off
+        int fromHour, toHour; // Active for fromHour <= hour < toHour (wraps past midnight)
+        vector<double> mask;  // 1.0 for items the deal applies to, else 0.0
+
+        bool activeAt(int hour) const
+        {
+            return fromHour <= toHour ? (hour >= fromHour && hour < toHour) : (hour >= fromHour || hour < toHour);
+        }
+    };
+
+    // A percentage discount when enough of a matching item is ordered at once
+    struct Bundle
+    {
+        string description;  // Human-readable summary
+        int minQuantity;     // Items needed to qualify
+        double percent;      // Fraction taken off the line
+        vector<double> mask; // 1.0 for items the bundle applies to, else 0.0
+    };
+
+    // A coupon code taking a percentage off orders above a minimum
+    struct Coupon
+    {
+        double percent;     // Fraction taken off
+        double minSubtotal; // Smallest subtotal the coupon applies to
+    };
+
+    // Price columns, one entry per menu item
+    vector<double> basePrices;     // Menu price
+    vector<size_t> restaurantOf;   // Restaurant index of each item
+    vector<string> categoryOf;     // Lowercase category of each item
+    vector<string> itemNameOf;     // Lowercase item name of each item
+    vector<size_t> firstItem;      // First item index of each restaurant
+    vector<string> restaurantNames; // Lowercase restaurant names
+    map<string, size_t> itemIds;   // "restaurant\titem" (lowercase) -> item index
+    map<string, size_t> branchIds; // "restaurant\tbranch" (lowercase) -> branch index
+
+    vector<Deal> deals;                    // Time-of-day deals
+    vector<Bundle> bundles;                // Quantity bundles
+    vector<vector<double>> branchOverrides; // Per branch: override price, or -1 for none
+    map<string, Coupon> coupons;           // Uppercase code -> coupon
+    double deepestDeal = 0;                // Largest deal percentage (bounds search pruning)
+
+    // Builds a 0/1 column of the items matching a restaurant/category/item pattern
+    vector<double> compileMask(const string &restaurant, const string &category, const string &item) const
+    {
+        vector<double> mask(basePrices.size(), 0.0);
+        for (size_t i = 0; i < basePrices.size(); i++)
+        {
+            bool matches = (restaurant == "*" || restaurantNames[restaurantOf[i]] == toLower(restaurant)) &&
+                           (category == "*" || categoryOf[i] == toLower(category)) &&
+                           (item == "*" || itemNameOf[i] == toLower(item));
+            mask[i] = matches ? 1.0 : 0.0;
+        }
+        return mask;
+    }
+
+    // Parses a whole field as a number between low and high; throws on junk or out-of-range values
+    static double parseNumber(const string &field, double low, double high)
+    {
+        size_t used = 0;
+        double value = stod(field, &used);
+        if (used != field.size() || !(value >= low && value <= high)) // Also rejects NaN
+            throw invalid_argument("bad number '" + field + "'");
+        return value;
+    }
+
+    // Parses a whole field as an integer between low and high; throws on junk or out-of-range values
+    static int parseWhole(const string &field, int low, int high)
+    {
+        size_t used = 0;
+        int value = stoi(field, &used);
+        if (used != field.size() || value < low || value > high)
+            throw invalid_argument("bad number '" + field + "'");
+        return value;
+    }
+
+    // Parses one promotion line; throws invalid_argument on malformed input
+    void addRule(const vector<string> &fields)
+    {
+        const double anyPrice = numeric_limits<double>::max(); // Upper bound for prices (rejects infinity)
+        const string &kind = fields[0];
+        if (kind == "deal" && fields.size() == 7)
+        {
+            double percent = parseNumber(fields[4], 0, 100) / 100;
+            int fromHour = parseWhole(fields[5], 0, 24), toHour = parseWhole(fields[6], 0, 24);
+            deals.push_back({fields[4] + "% off " + describe(fields[1], fields[2], fields[3]) + " from " +
+                                 fields[5] + ":00 to " + fields[6] + ":00",
+                             percent, fromHour, toHour, compileMask(fields[1], fields[2], fields[3])});
+            deepestDeal = max(deepestDeal, percent);
+        }
+        else if (kind == "override" && fields.size() == 5)
+        {
+            auto branch = branchIds.find(toLower(fields[1]) + '\t' + toLower(fields[2]));
+            auto item = itemIds.find(toLower(fields[1]) + '\t' + toLower(fields[3]));
+            if (branch == branchIds.end() || item == itemIds.end())
+                throw invalid_argument("unknown branch or item");
+            branchOverrides[branch->second][item->second] = parseNumber(fields[4], 0, anyPrice);
+        }
+        else if (kind == "bundle" && fields.size() == 6)
+        {
+            int minQuantity = parseWhole(fields[4], 1, numeric_limits<int>::max());
+            double percent = parseNumber(fields[5], 0, 100) / 100;
+            bundles.push_back({fields[5] + "% off " + describe(fields[1], fields[2], fields[3]) + " when you order " +
+                                   fields[4] + " or more",
+                               minQuantity, percent, compileMask(fields[1], fields[2], fields[3])});
+        }
+        else if (kind == "coupon" && fields.size() == 4)
+        {
+            string code = fields[1];
+            transform(code.begin(), code.end(), code.begin(), ::toupper);
+            Coupon coupon = {parseNumber(fields[2], 0, 100) / 100, parseNumber(fields[3], 0, anyPrice)};
+            coupons[code] = coupon;
+        }
+        else
+            throw invalid_argument("unknown promotion");
+    }
+
+    // Describes a restaurant/category/item pattern for listings
+    static string describe(const string &restaurant, const string &category, const string &item)
+    {
+        string what = item != "*" ? item : (category != "*" ? category : "everything");
+        return restaurant == "*" ? what : what + " at " + restaurant;
+    }
+
+    // Returns the local hour of a time. Uses the reentrant localtime variant, as
+    // quote() runs on the pipeline's price stage while menus are priced on the main thread.
+    static int hourOf(time_t when)
+    {
+        tm local{};
+#ifdef _WIN32
+        if (localtime_s(&local, &when) != 0)
+            return 0;
+#else
+        if (localtime_r(&when, &local) == nullptr)
+            return 0;
+#endif
+        return local.tm_hour;
+    }
+
+public:
+    // Constructor builds the price columns from the catalog snapshot
+    explicit PromotionEngine(const CatalogSnapshot &snapshot)
+    {
+        for (size_t r = 0; r < snapshot.restaurantCount(); r++)
+        {
+            restaurantNames.push_back(toLower(string(snapshot.restaurantName(r))));
+            firstItem.push_back(basePrices.size());
+            for (size_t c = 0; c < snapshot.categoryCount(r); c++)
+            {
+                for (size_t i = 0; i < snapshot.itemCount(r, c); i++)
+                {
+                    string item = toLower(string(snapshot.itemName(r, c, i)));
+                    itemIds[restaurantNames[r] + '\t' + item] = basePrices.size();
+                    basePrices.push_back(snapshot.itemPrice(r, c, i));
+                    restaurantOf.push_back(r);
+                    categoryOf.push_back(toLower(string(snapshot.categoryName(r, c))));
+                    itemNameOf.push_back(item);
+                }
+            }
+            for (size_t b = 0; b < snapshot.branchCount(r); b++)
+            {
+                branchIds[restaurantNames[r] + '\t' + toLower(string(snapshot.branchName(r, b)))] = branchOverrides.size();
+                branchOverrides.emplace_back();
+            }
+        }
+        for (auto &column : branchOverrides)
+            column.assign(basePrices.size(), -1.0); // Sized once every item is known
+    }
+
+    // Loads promotions from a file; a missing file simply means no promotions
+    void load(const string &path)
+    {
+        ifstream in(path);
+        string line;
+        int lineNumber = 0;
+        while (getline(in, line))
+        {
+            lineNumber++;
+            line = trim(line.substr(0, line.find('#')));
+            if (line.empty())
+                continue;
+            vector<string> fields;
+            size_t start = 0, bar;
+            while ((bar = line.find('|', start)) != string::npos)
+            {
+                fields.push_back(trim(line.substr(start, bar - start)));
+                start = bar + 1;
+            }
+            fields.push_back(trim(line.substr(start)));
+            fields[0] = toLower(fields[0]);
+            try
+            {
+                addRule(fields);
+            }
+            catch (const exception &)
+            {
+                cout << " Warning: Skipping invalid promotion on line " << lineNumber << " of " << path << ".\n";
+            }
+        }
+    }
+
+    // Looks up an item's index, returning false if it is not on the menu
+    bool findItem(const string &restaurant, const string &item, size_t &id) const
+    {
+        auto it = itemIds.find(toLower(restaurant) + '\t' + toLower(item));
+        if (it == itemIds.end())
+            return false;
+        id = it->second;
+        return true;
+    }
+
+    // Looks up a branch's index, or returns -1
+    int findBranch(const string &restaurant, const string &branch) const
+    {
+        auto it = branchIds.find(toLower(restaurant) + '\t' + toLower(branch));
+        return it == branchIds.end() ? -1 : static_cast<int>(it->second);
+    }
+
+    // Index of a restaurant's first item in the price columns
+    size_t firstItemOf(size_t restaurant) const { return firstItem[restaurant]; }
+
+    // Number of items across every restaurant's menu
+    size_t itemCount() const { return basePrices.size(); }
+
+    // Largest fraction any deal can take off a price
+    double maxDealPercent() const { return deepestDeal; }
+
+    // Prices every menu item at a given time, deals included. Branch overrides apply
+    // only to a placed order (see quote()). Each pass is a branch-free loop over
+    // contiguous columns, so it vectorizes at -O3.
+    vector<double> evaluate(time_t when) const
+    {
+        size_t count = basePrices.size();
+        int hour = hourOf(when);
+        vector<double> best(count, 0.0); // Deepest active deal per item
+        for (const auto &deal : deals)
+        {
+            if (!deal.activeAt(hour))
+                continue;
+            const double percent = deal.percent;
+            const double *mask = deal.mask.data();
+            double *out = best.data();
+            for (size_t i = 0; i < count; i++)
+                out[i] = max(out[i], percent * mask[i]);
+        }
+
+        vector<double> prices(count);
+        const double *base = basePrices.data();
+        for (size_t i = 0; i < count; i++)
+            prices[i] = base[i] * (1.0 - best[i]);
+        return prices;
+    }
+
+    // Prices one order line, applying deals, branch overrides, bundles and a coupon
+    OrderQuote quote(size_t item, int quantity, time_t when, int branch, const string &couponCode) const
+    {
+        OrderQuote result;
+        int hour = hourOf(when);
+        double bestDeal = 0;
+        for (const auto &deal : deals)
+        {
+            if (deal.activeAt(hour))
+                bestDeal = max(bestDeal, deal.percent * deal.mask[item]);
+        }
+        result.unitPrice = basePrices[item] * (1.0 - bestDeal);
+        if (branch >= 0 && branchOverrides[branch][item] >= 0)
+            result.unitPrice = branchOverrides[branch][item];
+
+        result.quantity = max(1, quantity);
+        result.subtotal = result.unitPrice * result.quantity;
+
+        double bestBundle = 0;
+        for (const auto &bundle : bundles)
+        {
+            if (result.quantity >= bundle.minQuantity)
+                bestBundle = max(bestBundle, bundle.percent * bundle.mask[item]);
+        }
+        result.bundleDiscount = result.subtotal * bestBundle;
+
+        string code = couponCode;
+        transform(code.begin(), code.end(), code.begin(), ::toupper);
+        auto coupon = coupons.find(code);
+        double discounted = result.subtotal - result.bundleDiscount;
+        if (coupon != coupons.end() && discounted >= coupon->second.minSubtotal)
+        {
+            result.couponDiscount = discounted * coupon->second.percent;
+            result.couponAccepted = true;
+        }
+
+        result.tax = 0.15 * (discounted - result.couponDiscount); // 15% tax
+        result.total = discounted - result.couponDiscount + result.tax;
+        return result;
+    }
+
+    // Lists the deals active at a time and the bundles and coupons on offer
+    void printPromotions(time_t when) const
+    {
+        int hour = hourOf(when);
+        bool any = false;
+        for (const auto &deal : deals)
+        {
+            if (deal.activeAt(hour))
+            {
+                cout << "   • " << deal.description << "\n";
+                any = true;
+            }
+        }
+        for (const auto &bundle : bundles)
+        {
+            cout << "   • " << bundle.description << "\n";
+            any = true;
+        }
+        for (const auto &coupon : coupons)
+        {
+            cout << "   • Coupon " << coupon.first << ": " << coupon.second.percent * 100 << "% off orders from Rs "
+                 << coupon.second.minSubtotal << "\n";
+            any = true;
+        }
+        if (!any)
+            cout << " No deals running right now.\n";
+    }
+};
+
+// -------------------- Order Dispatch Pipeline --------------------
+// Confirmed orders flow through four stages (validate -> price -> persist ->
+// dispatch), each on its own thread, connected by bounded lock-free queues.
+// A full queue blocks its producer, so a slow stage pushes back on the stages
+// before it instead of letting memory grow. The last stage hands orders to a
+// simulated kitchen for the chosen branch.
+
+// An order travelling through the pipeline
+struct OrderTicket
+{
+    uint64_t id = 0;      // Ticket number
+    long number = 0;      // The user's order number, as listed by 'my orders' (set by submit)
+    string user;          // Name of the user who placed the order
+    string restaurant;    // Restaurant name
+    string category;      // Menu category
+    string item;          // Item name
+    int quantity = 1;     // Number of items
+    string coupon;        // Coupon code (may be empty)
+    size_t itemId = 0;    // Index of the item in the price columns (set by the validate stage)
+    double price = 0;     // Unit price after deals (set by the price stage)
+    double discount = 0;  // Bundle and coupon discounts (set by the price stage)
+    double tax = 0;       // Tax (set by the price stage)
+    double total = 0;     // Amount to pay (set by the price stage)
+    string branch;        // Requested branch, or empty; set to the preparing branch by the dispatch stage
+    time_t placed = 0;    // When the order was confirmed
+};
+
+// Bounded single-producer/single-consumer ring buffer. Each pipeline queue has
+// exactly one writing stage and one reading stage, so two atomic counters are
+// all the synchronization it needs.
+template <typename T>
+class SpscQueue
+{
+    vector<T> slots;                  // Ring storage (power-of-two size)
+    size_t mask;                      // slots.size() - 1
+    alignas(64) atomic<size_t> head;  // Next slot to read (advanced by the consumer)
+    alignas(64) atomic<size_t> tail;  // Next slot to write (advanced by the producer)
+    alignas(64) atomic<size_t> peak;  // Deepest the queue has been
+
+public:
+    // Constructor rounds the capacity up to a power of two
+    explicit SpscQueue(size_t capacity) : head(0), tail(0), peak(0)
+    {
+        size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    // Adds an item, returning false if the queue is full
+    bool tryPush(T &item)
+    {
+        size_t t = tail.load(memory_order_relaxed);
+        size_t depth = t - head.load(memory_order_acquire);
+        if (depth == slots.size())
+            return false;
+        slots[t & mask] = move(item);
+        tail.store(t + 1, memory_order_release);
+        if (depth + 1 > peak.load(memory_order_relaxed))
+            peak.store(depth + 1, memory_order_relaxed);
+        return true;
+    }
+
+    // Removes the oldest item, returning false if the queue is empty
+    bool tryPop(T &item)
+    {
+        size_t h = head.load(memory_order_relaxed);
+        if (h == tail.load(memory_order_acquire))
+            return false;
+        item = move(slots[h & mask]);
+        head.store(h + 1, memory_order_release);
+        return true;
+    }
+
+    size_t depth() const { return tail.load(memory_order_acquire) - head.load(memory_order_acquire); }
+    size_t peakDepth() const { return peak.load(memory_order_relaxed); }
+    size_t capacity() const { return slots.size(); }
+};
+
+// Simulates the kitchens of every branch. Each branch has a few cooking
+// stations; an order goes to the restaurant's branch whose next station frees
+// up first, and the wait until a station is free is recorded. No real time
+// passes, so the simulator accepts orders as fast as the pipeline delivers them.
+class KitchenSimulator
+{
+    // Simulated state and statistics for one branch
+    struct Branch
+    {
+        string restaurant;           // Restaurant the branch belongs to
+        string name;                 // Branch name
+        vector<time_t> stationFreeAt; // When each station finishes its current order
+        uint64_t orders = 0;         // Orders received
+        double totalWait = 0;        // Sum of simulated waits, in seconds
+        double peakWait = 0;         // Longest simulated wait, in seconds
+    };
+
+    static constexpr int stationsPerBranch = 4; // Orders a branch can cook at once
+    static constexpr int prepSeconds = 10 * 60; // Simulated preparation time per order
+
+    mutable mutex kitchenLock; // Guards branches (dispatch stage writes, reports read)
+    vector<Branch> branches;   // Every branch of every restaurant
+
+public:
+    // Constructor creates a simulated kitchen for every branch
+    explicit KitchenSimulator(const CatalogSnapshot &snapshot)
+    {
+        for (size_t r = 0; r < snapshot.restaurantCount(); r++)
+        {
+            for (size_t b = 0; b < snapshot.branchCount(r); b++)
+                branches.push_back({string(snapshot.restaurantName(r)), string(snapshot.branchName(r, b)),
+                                    vector<time_t>(stationsPerBranch, 0)});
+        }
+    }
+
+    // Sends an order to its requested branch, or else the least busy branch of its restaurant;
+    // returns false if there is no such branch
+    bool accept(OrderTicket &ticket)
+    {
+        lock_guard<mutex> guard(kitchenLock);
+        Branch *best = nullptr;
+        vector<time_t>::iterator bestStation;
+        for (auto &branch : branches)
+        {
+            if (branch.restaurant != ticket.restaurant || (!ticket.branch.empty() && toLower(branch.name) != toLower(ticket.branch)))
+                continue;
+            auto station = min_element(branch.stationFreeAt.begin(), branch.stationFreeAt.end());
+            if (best == nullptr || *station < *bestStation)
+            {
+                best = &branch;
+                bestStation = station;
+            }
+        }
+        if (best == nullptr)
+            return false;
+
+        time_t start = max(*bestStation, ticket.placed);
+        double wait = difftime(start, ticket.placed);
+        *bestStation = start + prepSeconds;
+        best->orders++;
+        best->totalWait += wait;
+        best->peakWait = max(best->peakWait, wait);
+        ticket.branch = best->name;
+        return true;
+    }
+
+    // Prints per-branch load and simulated waiting times
+    void printReport() const
+    {
+        lock_guard<mutex> guard(kitchenLock);
+        ios format(nullptr);
+        format.copyfmt(cout); // Restore the caller's number format afterwards
+        cout << " " << left << setw(24) << "Branch" << right << setw(8) << "Orders"
+             << setw(14) << "Avg wait" << setw(14) << "Peak wait" << "\n";
+        for (const auto &branch : branches)
+        {
+            double average = branch.orders ? branch.totalWait / branch.orders : 0;
+            cout << " " << left << setw(24) << (branch.restaurant + " " + branch.name) << right
+                 << setw(8) << branch.orders << fixed << setprecision(1)
+                 << setw(10) << average / 60 << " min" << setw(10) << branch.peakWait / 60 << " min\n";
+        }
+        cout.copyfmt(format);
+    }
+};
+
+// The staged order pipeline: validate -> price -> persist -> dispatch
+class OrderPipeline
+{
+    // Counters for one stage, updated only by that stage's thread
+    struct StageStats
+    {
+        atomic<uint64_t> processed{0}; // Tickets passed on to the next stage
+        atomic<uint64_t> rejected{0};  // Tickets dropped by this stage
+        atomic<uint64_t> stalls{0};    // Times the stage waited on a full output queue
+        atomic<uint64_t> busyNanos{0};  // Time spent handling tickets, excluding waits on a full output queue
+        atomic<uint64_t> stallNanos{0}; // Time spent waiting on a full output queue
+    };
+
+    static constexpr size_t queueCapacity = 1024; // Slots per inter-stage queue
+    static constexpr size_t persistBatch = 64;    // Most tickets written per group commit
+    static constexpr int stageCount = 4;
+    static constexpr int parkAfter = 1000;        // Idle rounds (about 1 s) before a stage parks
+
+    const PromotionEngine &pricing;     // Current prices and promotions
+    KeyValueStore *store;               // Order index (may be null)
+    string historyFile;                 // Text order log
+    KitchenSimulator &kitchen;          // Receives dispatched orders
+    map<string, long> nextOrderNumber;  // Per-user order numbers (submitting thread only)
+
+    array<unique_ptr<SpscQueue<OrderTicket>>, stageCount> queues; // Input queue of each stage
+    array<StageStats, stageCount> stats;                          // Counters of each stage
+    atomic<uint64_t> submitted{0};      // Tickets accepted by submit()
+    atomic<uint64_t> finished{0};       // Tickets dispatched or rejected
+    atomic<uint64_t> submitStalls{0};   // Times submit() waited on a full first queue
+    atomic<uint64_t> unlogged{0};       // Orders the persist stage could not write to the text log
+    atomic<bool> stopping{false};       // Set when the pipeline should drain and exit
+    mutex parkLock;                     // Guards parking of idle stages
+    condition_variable wakeStage;       // Wakes parked stages when work arrives or on shutdown
+    atomic<int> parkedStages{0};        // Stages currently parked
+    array<thread, stageCount> workers;  // Stage threads (declared last so they start after the rest)
+
+    // Waits with growing pauses so idle stages do not burn a core
+    static void backoff(int &idleRounds)
+    {
+        if (idleRounds < parkAfter) // Capped so a long wait cannot overflow it
+            idleRounds++;
+        if (idleRounds < 64)
+            this_thread::yield();
+        else
+            this_thread::sleep_for(chrono::microseconds(min(1000, idleRounds)));
+    }
+
+    // Sleeps an idle stage until its queue has work or the pipeline stops. The timeout
+    // is only a safety net; producers wake parked stages through wakeParked().
+    void park(int stage)
+    {
+        unique_lock<mutex> guard(parkLock);
+        parkedStages.fetch_add(1); // Pairs with the read-modify-write in wakeParked()
+        wakeStage.wait_for(guard, chrono::seconds(1),
+                           [&] { return queues[stage]->depth() > 0 || stopping.load(memory_order_acquire); });
+        parkedStages.fetch_sub(1);
+    }
+
+    // Wakes parked stages after a push. Reading the count with a read-modify-write orders it
+    // against park(): either the parking stage sees the push, or we see it parked.
+    void wakeParked()
+    {
+        if (parkedStages.fetch_add(0) == 0)
+            return;
+        lock_guard<mutex> guard(parkLock);
+        wakeStage.notify_all();
+    }
+
+    // Nanoseconds since a time point
+    static uint64_t nanosSince(chrono::steady_clock::time_point since)
+    {
+        return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - since).count();
+    }
+
+    // Pushes into a queue, waiting while it is full (backpressure); returns the nanoseconds waited
+    static uint64_t pushBlocking(SpscQueue<OrderTicket> &queue, OrderTicket &ticket, atomic<uint64_t> &stalls)
+    {
+        if (queue.tryPush(ticket))
+            return 0;
+        stalls.fetch_add(1, memory_order_relaxed);
+        auto waiting = chrono::steady_clock::now();
+        int idleRounds = 0;
+        do
+            backoff(idleRounds);
+        while (!queue.tryPush(ticket));
+        return nanosSince(waiting);
+    }
+
+    // Records a ticket that left the pipeline early
+    void reject(int stage)
+    {
+        stats[stage].rejected.fetch_add(1, memory_order_relaxed);
+        finished.fetch_add(1, memory_order_release);
+    }
+
+    // Hands a ticket to the next stage
+    void forward(int stage, OrderTicket &ticket)
+    {
+        uint64_t waited = pushBlocking(*queues[stage + 1], ticket, stats[stage].stalls);
+        wakeParked();
+        stats[stage].stallNanos.fetch_add(waited, memory_order_relaxed);
+        stats[stage].processed.fetch_add(1, memory_order_relaxed);
+    }
+
+    // Stage 1: drops orders for restaurants or items that are not on the menu
+    void validate(OrderTicket &ticket)
+    {
+        if (ticket.user.empty() || ticket.quantity < 1 || !pricing.findItem(ticket.restaurant, ticket.item, ticket.itemId))
+            return reject(0);
+        if (!ticket.branch.empty() && pricing.findBranch(ticket.restaurant, ticket.branch) < 0)
+            return reject(0);
+        forward(0, ticket);
+    }
+
+    // Stage 2: prices the order from the catalog and promotions, never from the client
+    void price(OrderTicket &ticket)
+    {
+        int branch = ticket.branch.empty() ? -1 : pricing.findBranch(ticket.restaurant, ticket.branch);
+        OrderQuote quote = pricing.quote(ticket.itemId, ticket.quantity, ticket.placed, branch, ticket.coupon);
+        ticket.price = quote.unitPrice;
+        ticket.discount = quote.bundleDiscount + quote.couponDiscount;
+        ticket.tax = quote.tax;
+        ticket.total = quote.total;
+        forward(1, ticket);
+    }
+
+    // Stage 3: writes a batch of orders to the text log and the user order index
+    void persist(vector<OrderTicket> &batch)
+    {
+        try
+        {
+            ofstream fout(historyFile, ios::app); // Open file in append mode
+            if (!fout)
+                unlogged.fetch_add(batch.size(), memory_order_relaxed); // Still stored and dispatched; counted for the warning
+            vector<pair<string, string>> records;
+            map<string, long> counts;
+            for (auto &ticket : batch)
+            {
+                fout << "Restaurant: " << ticket.restaurant << "\n";
+                fout << "Item: " << ticket.item << "\n";
+                fout << "Price: Rs " << ticket.price << "\n";
+                if (ticket.quantity > 1)
+                    fout << "Quantity: " << ticket.quantity << "\n";
+                if (ticket.discount > 0)
+                    fout << "Discount: Rs " << ticket.discount << "\n";
+                fout << "Tax: Rs " << ticket.tax << "\n";
+                fout << "Total: Rs " << ticket.total << "\n";
+                fout << "-----------------------------\n";
+
+                if (!store)
+                    continue;
+                string user = toLower(ticket.user);
+                counts[user] = max(counts[user], ticket.number);
+
+                ostringstream key, value;
+                key << "orders/" << user << "/" << setw(10) << setfill('0') << ticket.number; // Zero-padded so keys sort by order number
+                value << ticket.restaurant << '\t' << ticket.category << '\t' << ticket.item << '\t'
+                      << ticket.price << '\t' << ticket.total << '\t' << ticket.placed;
+                records.emplace_back(key.str(), value.str());
+            }
+            // Counts go first: after a torn batch they can only run ahead, never reuse a number
+            for (const auto &count : counts)
+                records.insert(records.begin(), {"profile/" + count.first + "/orders", to_string(count.second)});
+            if (store && !records.empty())
+                store->putAll(records);
+            if (fout.is_open() && !fout.flush())
+                unlogged.fetch_add(batch.size(), memory_order_relaxed); // Opened, but the writes failed
+        }
+        catch (const exception &)
+        {
+            for (size_t i = 0; i < batch.size(); i++)
+                reject(2);
+            batch.clear();
+            return;
+        }
+        for (auto &ticket : batch)
+            forward(2, ticket);
+    }
+
+    // Stage 4: hands the order to the simulated kitchen of a branch
+    void dispatch(OrderTicket &ticket)
+    {
+        if (!kitchen.accept(ticket))
+            return reject(3);
+        stats[3].processed.fetch_add(1, memory_order_relaxed);
+        finished.fetch_add(1, memory_order_release);
+    }
+
+    // Thread body for one stage; exits once stopping and all earlier stages are drained
+    void runStage(int stage)
+    {
+        int idleRounds = 0;
+        vector<OrderTicket> batch;
+        OrderTicket ticket;
+        while (true)
+        {
+            while (batch.size() < persistBatch && queues[stage]->tryPop(ticket))
+            {
+                batch.push_back(move(ticket));
+                if (stage != 2) // Only the persist stage batches
+                    break;
+            }
+
+            if (batch.empty())
+            {
+                if (stopping.load(memory_order_acquire) && finished.load(memory_order_acquire) == submitted.load(memory_order_acquire))
+                    return;
+                if (idleRounds < parkAfter || stopping.load(memory_order_acquire))
+                    backoff(idleRounds);
+                else
+                    park(stage);
+                continue;
+            }
+            idleRounds = 0;
+
+            auto begin = chrono::steady_clock::now();
+            uint64_t stalledBefore = stats[stage].stallNanos.load(memory_order_relaxed);
+            if (stage == 0)
+                validate(batch.front());
+            else if (stage == 1)
+                price(batch.front());
+            else if (stage == 2)
+                persist(batch);
+            else
+                dispatch(batch.front());
+            batch.clear();
+            uint64_t elapsed = nanosSince(begin);
+            uint64_t stalled = stats[stage].stallNanos.load(memory_order_relaxed) - stalledBefore;
+            stats[stage].busyNanos.fetch_add(elapsed - min(stalled, elapsed), memory_order_relaxed);
+        }
+    }
+
+public:
+    // Constructor creates the queues and starts the stage threads
+    OrderPipeline(const PromotionEngine &pricing, KeyValueStore *store, string historyFile, KitchenSimulator &kitchen)
+        : pricing(pricing), store(store), historyFile(historyFile), kitchen(kitchen)
+    {
+        for (auto &queue : queues)
+            queue = make_unique<SpscQueue<OrderTicket>>(queueCapacity);
+        for (int stage = 0; stage < stageCount; stage++)
+            workers[stage] = thread(&OrderPipeline::runStage, this, stage);
+    }
+
+    // Queues a confirmed order and returns the user's order number for it; blocks while
+    // the pipeline is full. Call from one thread only. Numbers are taken here, not when the
+    // order is stored, so the confirmation matches 'my orders'; a rejected order leaves a gap.
+    long submit(OrderTicket ticket)
+    {
+        string user = toLower(ticket.user);
+        if (nextOrderNumber.count(user) == 0) // First order from this user since start-up
+        {
+            string count = "0";
+            if (store)
+                store->get("profile/" + user + "/orders", count);
+            nextOrderNumber[user] = stol(count) + 1;
+        }
+        long number = nextOrderNumber[user]++;
+        ticket.number = number;
+        ticket.id = submitted.load(memory_order_relaxed) + 1;
+        submitted.fetch_add(1, memory_order_release);
+        pushBlocking(*queues[0], ticket, submitStalls);
+        wakeParked();
+        return number;
+    }
+
+    // Orders that could not be written to the text log so far
+    uint64_t unloggedOrders() const
+    {
+        return unlogged.load(memory_order_relaxed);
+    }
+
+    // Waits until every submitted order has been dispatched or rejected
+    void waitUntilIdle() const
+    {
+        while (finished.load(memory_order_acquire) != submitted.load(memory_order_acquire))
+            this_thread::sleep_for(chrono::microseconds(100));
+    }
+
+    // Prints each stage's load, capacity and queue depth. Capacity is orders handled per
+    // second of busy time, so idle time and backpressure waits do not dilute it.
+    void printReport() const
+    {
+        static const array<const char *, stageCount> names = {"validate", "price", "persist", "dispatch"};
+        ios format(nullptr);
+        format.copyfmt(cout); // Restore the caller's number format afterwards
+        cout << " Submitted: " << submitted.load() << "   Completed: " << finished.load()
+             << "   Submit stalls: " << submitStalls.load() << "   Unlogged: " << unlogged.load() << "\n";
+        cout << " " << left << setw(10) << "Stage" << right << setw(10) << "Passed" << setw(10) << "Rejected"
+             << setw(11) << "Busy ms" << setw(13) << "Capacity/s" << setw(16) << "Queue now/peak" << setw(9) << "Stalls" << "\n";
+        for (int stage = 0; stage < stageCount; stage++)
+        {
+            ostringstream depth, capacity;
+            depth << queues[stage]->depth() << "/" << queues[stage]->peakDepth();
+            uint64_t handled = stats[stage].processed.load() + stats[stage].rejected.load();
+            double busy = stats[stage].busyNanos.load() / 1e9;
+            if (busy > 0)
+                capacity << fixed << setprecision(0) << handled / busy;
+            else
+                capacity << "-";
+            cout << " " << left << setw(10) << names[stage] << right << setw(10) << stats[stage].processed.load()
+                 << setw(10) << stats[stage].rejected.load() << setw(11) << fixed << setprecision(1) << busy * 1000
+                 << setw(13) << capacity.str() << setw(16) << depth.str() << setw(9) << stats[stage].stalls.load() << "\n";
+        }
+        cout << " Queue capacity: " << queues[0]->capacity() << " per stage"
+             << "   (Capacity/s = orders per second of busy time)\n";
+        cout.copyfmt(format);
+    }
+
+    // Drains every queued order, then stops the stage threads
+    ~OrderPipeline()
+    {
+        stopping.store(true, memory_order_release);
+        wakeParked();
+        for (auto &worker : workers)
+            worker.join();
+    }
+};
+
+// -------------------- ChefBot Class --------------------
+// The main chatbot class that interacts with restaurants
+class ChefBot
+{
+    // How long each part of start-up took, in milliseconds
+    struct StartupTimings
+    {
+        double snapshot = 0;    // Mapping (or rebuilding) the catalog snapshot
+        double indexes = 0;     // Building shard, price and kitchen indexes
+        double store = 0;       // Opening the user data store
+        double pipeline = 0;    // Starting the order pipeline
+        double firstQuery = -1; // Handling the first command (-1 until it has run)
+        bool firstQueryPrompted = false; // True if the first command was timed up to its first prompt
+        bool rebuilt = false;   // True if the snapshot had to be regenerated
+    };
+
+    static constexpr const char *dataDir = "chefbot_data"; // Saved user data, and scratch stores of simulations
+
+    CatalogSnapshot snapshot;         // Memory-mapped catalog image everything else is built from
+    vector<Restaurant *> restaurants; // Pointers to all supported restaurants (null until first used)
+    Catalog catalog;                  // City-sharded indexes over the restaurants
+    unique_ptr<KeyValueStore> store;  // Persistent user data (null if the store could not be opened)
+    string currentUser = "guest";     // Name of the signed-in user
+    unique_ptr<KitchenSimulator> kitchen; // Simulated branch kitchens that receive dispatched orders
+    unique_ptr<PromotionEngine> pricing;  // Price columns and compiled promotions
+    unique_ptr<OrderPipeline> pipeline;   // Validates, prices, persists and dispatches confirmed orders
+    unique_ptr<RatingBoard> ratings;      // Lock-free customer rating aggregates per restaurant and item
+    StartupTimings timings;               // Start-up breakdown for 'startup report'
+    chrono::steady_clock::time_point queryReceived; // When the command being handled arrived
+    uint64_t unloggedWarned = 0;          // Unlogged orders already warned about
+
+    // Milliseconds since a time point, restarting it for the next phase
+    static double lap(chrono::steady_clock::time_point &since)
+    {
+        auto now = chrono::steady_clock::now();
+        double ms = chrono::duration<double, milli>(now - since).count();
+        since = now;
+        return ms;
+    }
+
+    // Per-user cache directory for the snapshot when the working directory is read-only
+    // (empty if unknown). A shared directory such as /tmp is never used, since any
+    // local user could plant an image there.
+    static string snapshotCacheDir()
+    {
+#ifdef _WIN32
+        const char *local = getenv("LOCALAPPDATA");
+        return (local && *local) ? string(local) + "\\chefbot" : "";
+#else
+        const char *cache = getenv("XDG_CACHE_HOME");
+        if (cache && *cache == '/')
+            return string(cache) + "/chefbot";
+        const char *home = getenv("HOME");
+        return (home && *home) ? string(home) + "/.cache/chefbot" : "";
+#endif
+    }
+
+    // Writes a snapshot of the built-in restaurant classes to the working directory and
+    // maps it. Only if that write fails is the per-user cache used: an image an earlier
+    // run of this build left there, or else a new one. Returns true if an image was written.
+    bool rebuildSnapshot()
+    {
+        restaurants.push_back(new Cheezious());
+        restaurants.push_back(new Ranchers());
+        restaurants.push_back(new Howdy());
+
+        string reason;
+        try
+        {
+            CatalogSnapshot::write("catalog.snapshot", restaurants);
+            if (snapshot.open("catalog.snapshot"))
+                return true;
+            reason = "catalog.snapshot could not be read back";
+        }
+        catch (const exception &e)
+        {
+            reason = e.what();
+        }
+
+        string cacheDir = snapshotCacheDir();
+        if (cacheDir.empty())
+            throw runtime_error("could not create a catalog snapshot: " + reason);
+        string cached = cacheDir + "/catalog.snapshot";
+        if (snapshot.open(cached))
+        {
+            for (auto &r : restaurants) // Restaurants are materialized lazily from the cached image instead
+                delete r;
+            restaurants.clear();
+            return false;
+        }
+        try
+        {
+            filesystem::create_directories(cacheDir);
+            filesystem::permissions(cacheDir, filesystem::perms::owner_all, filesystem::perm_options::replace);
+            CatalogSnapshot::write(cached, restaurants);
+            if (snapshot.open(cached))
+                return true;
+            reason = cached + " could not be read back";
+        }
+        catch (const exception &e)
+        {
+            reason = e.what();
+        }
+        throw runtime_error("could not create a catalog snapshot: " + reason);
+    }
+
+public:
+    // Constructor maps the catalog snapshot (rebuilding it from the derived restaurant
+    // classes when it is missing or stale) and builds every index from it. Restaurant
+    // objects themselves are only created when a command needs one.
+    ChefBot()
+    {
+        auto phase = chrono::steady_clock::now();
+        try
+        {
+            if (!snapshot.open("catalog.snapshot"))
+                timings.rebuilt = rebuildSnapshot();
+            restaurants.resize(snapshot.restaurantCount(), nullptr);
+            timings.snapshot = lap(phase);
+
+            catalog.build(snapshot); // Index the restaurants by city and start the shard workers
+            kitchen = make_unique<KitchenSimulator>(snapshot);
+            pricing = make_unique<PromotionEngine>(snapshot);
+            pricing->load("promotions.txt"); // Optional; without it menu prices apply unchanged
+            ratings = make_unique<RatingBoard>(snapshot.restaurantCount(), pricing->itemCount());
+            for (size_t i = 0; i < restaurants.size(); i++) // Restaurants built while rebuilding the snapshot
+            {
+                if (restaurants[i] != nullptr)
+                    restaurants[i]->attachRatings(&ratings->restaurant(i));
+            }
+            timings.indexes = lap(phase);
+        }
+        catch (const bad_alloc &e)
+        {
+            cout << "Memory allocation failed: " << e.what() << endl;
+            throw;
+        }
+
+        try
+        {
+            store = make_unique<KeyValueStore>(dataDir); // Recovers any writes from the last run
+            string user;
+            if (store->get("session/current", user) && isValidUserName(user))
+                currentUser = user; // Resume the previous session
+            loadRatings();
+        }
+        catch (const exception &e)
+        {
+            cout << " Warning: Could not open saved user data: " << e.what() << endl;
+            store.reset();
+        }
+        timings.store = lap(phase);
+
+        pipeline = make_unique<OrderPipeline>(*pricing, store.get(), "order_history.txt", *kitchen);
+        timings.pipeline = lap(phase);
+    }
+
+    // Returns a restaurant, materializing it from the snapshot on first use
+    Restaurant *restaurantAt(size_t index)
+    {
+        if (restaurants[index] == nullptr)
+        {
+            restaurants[index] = new SnapshotRestaurant(snapshot, index);
+            restaurants[index]->attachRatings(&ratings->restaurant(index));
+        }
+        return restaurants[index];
+    }
+
+    // Restores the saved rating aggregates of every restaurant and menu item
+    void loadRatings()
+    {
+        for (size_t r = 0; r < snapshot.restaurantCount(); r++)
+        {
+            string restaurant = toLower(string(snapshot.restaurantName(r)));
+            loadRating("ratings/" + restaurant, ratings->restaurant(r));
+            size_t id = pricing->firstItemOf(r); // Items are numbered in snapshot order
+            for (size_t c = 0; c < snapshot.categoryCount(r); c++)
+            {
+                for (size_t i = 0; i < snapshot.itemCount(r, c); i++, id++)
+                    loadRating("ratings/" + restaurant + "/" + toLower(string(snapshot.itemName(r, c, i))), ratings->item(id));
+            }
+        }
+    }
+
+    // Restores one saved rating aggregate; a malformed record is skipped so it cannot disable the store
+    void loadRating(const string &key, RatingStats &stats)
+    {
+        string stars;
+        if (!store->get(key, stars))
+            return;
+        try
+        {
+            addEncodedStars(stats, stars);
+        }
+        catch (const exception &e)
+        {
+            cout << " Warning: Skipping saved rating " << key << ": " << e.what() << endl;
+        }
+    }
+
+    // Finds a restaurant by name (not case-sensitive) without materializing it; returns -1 if unknown
+    int findRestaurant(const string &name) const
+    {
+        for (size_t i = 0; i < snapshot.restaurantCount(); i++)
+        {
+            if (toLower(string(snapshot.restaurantName(i))) == toLower(trim(name)))
+                return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    // Records the first command's latency once: when it finishes, or when it first waits for the user
+    void stopFirstQueryClock(bool atPrompt)
+    {
+        if (timings.firstQuery >= 0)
+            return;
+        timings.firstQuery = chrono::duration<double, milli>(chrono::steady_clock::now() - queryReceived).count();
+        timings.firstQueryPrompted = atPrompt;
+    }
+
+    // Reads the answer to a prompt, so the user's typing is never counted as query latency
+    void readAnswer(string &answer)
+    {
+        stopFirstQueryClock(true);
+        getline(cin, answer);
+    }
+
+    // Shows how long each start-up phase and the first command took
+    void showStartupReport()
+    {
+        size_t materialized = count_if(restaurants.begin(), restaurants.end(), [](Restaurant *r) { return r != nullptr; });
+        double total = timings.snapshot + timings.indexes + timings.store + timings.pipeline;
+        ostringstream report;
+        report << fixed << setprecision(3);
+        report << " Catalog snapshot:  " << setw(9) << timings.snapshot << " ms  ("
+               << (timings.rebuilt ? "rebuilt from restaurant classes" : "mapped existing image") << ")\n";
+        report << " Index build:       " << setw(9) << timings.indexes << " ms  (city shards, price columns, kitchens)\n";
+        report << " User data store:   " << setw(9) << timings.store << " ms\n";
+        report << " Order pipeline:    " << setw(9) << timings.pipeline << " ms\n";
+        report << " Total start-up:    " << setw(9) << total << " ms\n";
+        if (timings.firstQuery >= 0)
+            report << " First query:       " << setw(9) << timings.firstQuery << " ms"
+                   << (timings.firstQueryPrompted ? "  (up to its first prompt)" : "") << "\n";
+        else
+            report << " First query:       (this is the first query)\n";
+        report << " Restaurants materialized: " << materialized << " of " << restaurants.size() << "\n";
+
+        cout << "\n STARTUP TIMING:\n";
+        cout << string(50, '-') << "\n";
+        cout << report.str();
+    }
+
+    // Greets the user and shows available commands
+    void greet()
+    {
+        cout << "\n" << string(60, '=') << "\n";
+        cout << " Welcome to ChefBot - Your Food Ordering Assistant!\n";
+        cout << string(60, '=') << "\n";
+        cout << "Type 'help' to see all available commands or 'exit' to quit.\n";
+        if (currentUser != "guest")
+            cout << "Welcome back, " << currentUser << "! Type 'reorder' to repeat your last order.\n";
+        cout << string(60, '=') << "\n";
+    }
+
+    // Shows help menu with all available commands, generated from helpTable
+    void showHelp()
+    {
+        cout << "\n" << string(50, '=') << "\n";
+        cout << " CHEFBOT COMMAND GUIDE\n";
+        cout << string(50, '=') << "\n";
+
+        string_view section;
+        for (const auto &entry : helpTable) // Iterate through the help entries in display order
+        {
+            if (entry.section != section) // Start a new section heading
+            {
+                if (!section.empty())
+                    cout << "\n";
+                section = entry.section;
+                cout << " " << section << ":\n";
+            }
+            cout << "   • '" << entry.usage << "' - " << entry.description << "\n";
+
+            // Show concrete examples for placeholder usages, and other phrasings for the rest
+            bool placeholder = entry.usage.find('[') != string_view::npos;
+            bool firstExample = true;
+            for (auto example : entry.examples)
+            {
+                if (example.empty())
+                    continue;
+                if (firstExample)
+                    cout << (placeholder ? "     Examples: '" : "     Also:     '") << example << "'\n";
+                else
+                    cout << "               '" << example << "'\n";
+                firstExample = false;
+            }
+        }
+
+        cout << string(50, '=') << "\n";
+        cout << " TIP: Commands are not case-sensitive!\n";
+        cout << string(50, '=') << "\n";
+    }
+
+    // Shows a quick command summary, generated from helpTable
+    void showQuickCommands()
+    {
+        cout << "\n Quick Commands:\n";
+        for (const auto &entry : helpTable)
+        {
+            if (!entry.quick.empty())
+                cout << "• " << entry.usage << " - " << entry.quick << "\n";
+        }
+    }
+
+    // Returns a restaurant's slice of a full-menu price evaluation
+    const double *pricesFor(const vector<double> &prices, const Restaurant *r) const
+    {
+        size_t index = find(restaurants.begin(), restaurants.end(), r) - restaurants.begin();
+        return prices.data() + pricing->firstItemOf(index);
+    }
+
+    // Shows the deals, bundles and coupons currently on offer
+    void showDeals()
+    {
+        cout << "\n DEALS AND COUPONS:\n";
+        cout << string(50, '-') << "\n";
+        pricing->printPromotions(time(0));
+    }
+
+    // Displays details for all registered restaurants
+    void showAllInfo()
+    {
+        cout << "\n ALL RESTAURANTS INFORMATION:\n";
+        vector<double> prices = pricing->evaluate(time(0)); // Current prices, deals included
+        for (size_t i = 0; i < restaurants.size(); i++) // Iterate through each restaurant
+            restaurantAt(i)->showDetails(pricesFor(prices, restaurantAt(i))); // Call showDetails for each restaurant
+    }
+
+    // Displays specific information (name, rating, menu, address) for all restaurants
+    void showByField(string field)
+    {
+        cout << "\n";
+        if (field == "name")
+        {
+            cout << " RESTAURANT NAMES:\n";
+            for (size_t i = 0; i < snapshot.restaurantCount(); i++) // Read from the snapshot, no need to materialize
+                cout << "   • " << snapshot.restaurantName(i) << endl;
+        }
+        else if (field == "rating")
+        {
+            cout << " RESTAURANT RATINGS:\n";
+            for (size_t i = 0; i < snapshot.restaurantCount(); i++)
+            {
+                RatingSnapshot view = ratings->restaurant(i).snapshot(); // Wait-free, even while ratings arrive
+                ostringstream line; // One decimal, as 'reviews' shows it
+                line << fixed << setprecision(1) << "   • " << snapshot.restaurantName(i) << ": "
+                     << view.blendedWith(snapshot.restaurantRating(i)) << "/5";
+                if (view.count > 0)
+                    line << " (" << view.count << " customer rating" << (view.count == 1 ? "" : "s") << ")";
+                cout << line.str() << "\n";
+            }
+        }
+        else if (field == "menu" || field == "prices")
+        {
+            cout << " ALL RESTAURANT MENUS:\n";
+            vector<double> prices = pricing->evaluate(time(0)); // Current prices, deals included
+            for (size_t i = 0; i < restaurants.size(); i++)
+            {
+                Restaurant *r = restaurantAt(i);
+                cout << "\n" << r->getName() << ":\n";
+                r->showMenu(pricesFor(prices, r));
+            }
+        }
+        else if (field == "address" || field == "branches")
+        {
+            cout << " RESTAURANT ADDRESSES:\n";
+            for (size_t i = 0; i < snapshot.restaurantCount(); i++)
+            {
+                cout << "\n" << snapshot.restaurantName(i) << ":\n";
+                for (size_t b = 0; b < snapshot.branchCount(i); b++)
+                    cout << "   • " << snapshot.branchAddress(i, b) << endl;
+            }
+        }
+        else
+        {
+            cout << " Sorry, I don't understand that field.\n";
+            cout << "Try: names, ratings, menu, addresses, or branches\n";
+        }
+    }
+
+    // Key prefix for the signed-in user's records in the store
+    string userKey() const { return toLower(currentUser); }
+
+    // Names become key prefixes, so they cannot contain the key separator '/' or the field separator tab
+    static bool isValidUserName(const string &name)
+    {
+        return !name.empty() && name.find_first_of("/\t") == string::npos;
+    }
+
+    // Signs a user in and remembers them for the next run
+    void login(string name)
+    {
+        name = trim(name);
+        if (name.empty())
+        {
+            cout << "Enter your name: ";
+            readAnswer(name);
+            name = trim(name);
+        }
+        if (name.empty())
+        {
+            cout << " Please enter a name to sign in.\n";
+            return;
+        }
+        if (!isValidUserName(name))
+        {
+            cout << " Names cannot contain '/' or tabs. Please choose another name.\n";
+            return;
+        }
+        currentUser = name;
+        if (!store)
+        {
+            cout << " Signed in as " << currentUser << " (your orders will not be saved).\n";
+            return;
+        }
+        try
+        {
+            string orders = "0";
+            bool returning = store->get("profile/" + userKey() + "/orders", orders);
+            store->put("profile/" + userKey() + "/name", currentUser);
+            store->put("session/current", currentUser);
+            if (returning)
+                cout << " Welcome back, " << currentUser << "! You have " << orders << " saved order(s).\n";
+            else
+                cout << " Signed in as " << currentUser << ". Your orders will be remembered.\n";
+        }
+        catch (const exception &e)
+        {
+            cout << " Warning: Could not save your session: " << e.what() << "\n";
+        }
+    }
+
+    // Removes the signed-in user's saved cart
+    void clearCart()
+    {
+        if (!store)
+            return;
+        try
+        {
+            store->erase("cart/" + userKey());
+        }
+        catch (const exception &e)
+        {
+            cout << " Warning: Could not update your cart: " << e.what() << "\n";
+        }
+    }
+
+    // Saves an unconfirmed item as the signed-in user's cart
+    void saveCart(const string &restName, const string &category, const MenuItem &item)
+    {
+        if (!store)
+            return;
+        try
+        {
+            store->put("cart/" + userKey(), restName + '\t' + category + '\t' + item.getName());
+            cout << " Saved to your cart. Type 'my cart' to order it later.\n";
+        }
+        catch (const exception &e)
+        {
+            cout << " Warning: Could not save your cart: " << e.what() << "\n";
+        }
+    }
 
-// -------------------- ChefBot Class --------------------
-// The main chatbot class that interacts with restaurants
-class ChefBot
-{
-    vector<Restaurant *> restaurants; // A vector to hold pointers to all supported restaurants
+    // Finds a restaurant and menu item by name, returning false if either no longer exists
+    bool findMenuItem(const string &restName, const string &category, const string &itemName,
+                      Restaurant *&selected, MenuItem &found)
+    {
+        int index = findRestaurant(restName);
+        if (index >= 0)
+        {
+            Restaurant *r = restaurantAt(index);
+            auto menu = r->getCategorizedMenu();
+            for (const auto &item : menu[category])
+            {
+                if (toLower(item.getName()) == toLower(itemName))
+                {
+                    selected = r;
+                    found = item;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
 
-public:
-    // Constructor to initialize ChefBot, adding instances of derived restaurant classes
-    ChefBot()
+    // Shows the signed-in user's most recent orders, newest first
+    void showOrderHistory(size_t count)
     {
-        try
+        if (!store)
         {
-            restaurants.push_back(new Cheezious());
-            restaurants.push_back(new Ranchers());
-            restaurants.push_back(new Howdy());
+            cout << " Order history is not available right now.\n";
+            return;
         }
-        catch (const bad_alloc &e)
+        pipeline->waitUntilIdle(); // Make sure orders just placed have been persisted
+        auto orders = store->scanNewest("orders/" + userKey() + "/", count);
+        cout << "\n LAST " << count << " ORDERS FOR " << currentUser << ":\n";
+        cout << string(50, '-') << "\n";
+        if (orders.empty())
+            cout << " No orders yet. Use 'order' to place one!\n";
+        for (const auto &order : orders)
         {
-            cout << "Memory allocation failed: " << e.what() << endl;
+            vector<string> fields = splitFields(order.second);
+            if (fields.size() < 5)
+                continue;
+            cout << "   • #" << stol(order.first.substr(order.first.size() - 10)) << " " << fields[2]
+                 << " from " << fields[0] << " - Rs " << fields[4] << "\n";
         }
     }
 
-    // Greets the user and shows available commands
-    void greet()
+    // Places the signed-in user's most recent order again
+    void reorder()
     {
-        cout << "\n" << string(60, '=') << "\n";
-        cout << " Welcome to ChefBot - Your Food Ordering Assistant!\n";
-        cout << string(60, '=') << "\n";
-        cout << "Type 'help' to see all available commands or 'exit' to quit.\n";
-        cout << string(60, '=') << "\n";
+        pipeline->waitUntilIdle(); // Make sure orders just placed have been persisted
+        auto last = store ? store->scanNewest("orders/" + userKey() + "/", 1) : vector<pair<string, string>>();
+        if (last.empty())
+        {
+            cout << " No previous order found for " << currentUser << ".\n";
+            return;
+        }
+        vector<string> fields = splitFields(last.front().second);
+        Restaurant *selected = nullptr;
+        MenuItem item("", 0);
+        if (fields.size() < 3 || !findMenuItem(fields[0], fields[1], fields[2], selected, item))
+        {
+            cout << " Your last order is no longer on the menu.\n";
+            return;
+        }
+        confirmOrder(selected, fields[1], item);
     }
 
-    // Shows help menu with all available commands
-    void showHelp()
+    // Shows the signed-in user's saved cart and offers to order it
+    void showCart()
     {
-        cout << "\n" << string(50, '=') << "\n";
-        cout << " CHEFBOT COMMAND GUIDE\n";
-        cout << string(50, '=') << "\n";
-        
-        cout << " INFORMATION COMMANDS:\n";
-        cout << "   • 'tell me about restaurants' - Show all restaurant info\n";
-        cout << "   • 'tell me about [restaurant name]' - Show specific restaurant\n";
-        cout << "     Examples: 'tell me about cheezious'\n";
-        cout << "               'tell me about ranchers'\n";
-        cout << "               'tell me about howdy'\n";
-        cout << "   • 'tell me about names' - Show restaurant names\n";
-        cout << "   • 'tell me about ratings' - Show restaurant ratings\n";
-        cout << "   • 'tell me about menu' - Show all menus\n";
-        cout << "   • 'tell me about addresses' - Show all addresses\n";
-        cout << "   • 'tell me about branches' - Show all branches\n\n";
-        
-        cout << " ORDERING COMMANDS:\n";
-        cout << "   • 'order' - Start the ordering process\n";
-        cout << "   • 'place order' - Alternative ordering command\n\n";
-        
-        cout << " RECOMMENDATION COMMANDS:\n";
-        cout << "   • 'recommend' - Show all items under Rs 500\n";
-        cout << "   • 'recommend burger' - Show burger recommendations\n";
-        cout << "   • 'recommend pizza' - Show pizza recommendations\n";
-        cout << "   • 'recommend pasta' - Show pasta recommendations\n";
-        cout << "   • 'recommend wrap' - Show wrap recommendations\n";
-        cout << "   • 'recommend sandwich' - Show sandwich recommendations\n\n";
-        
-        cout << " LOCATION COMMANDS:\n";
-        cout << "   • 'nearest branch' - Find branches in your city\n";
-        cout << "   • 'find branches' - Alternative branch finder\n\n";
-        
-        cout << " STATUS COMMANDS:\n";
-        cout << "   • '[restaurant name] open now' - Check if restaurant is open\n";
-        cout << "     Examples: 'cheezious open now'\n";
-        cout << "               'ranchers open status'\n";
-        cout << "               'howdy open now'\n\n";
-        
-        cout << " HELP & EXIT:\n";
-        cout << "   • 'help' - Show this command guide\n";
-        cout << "   • 'commands' - Show available commands\n";
-        cout << "   • 'exit' - Quit ChefBot\n";
-        
-        cout << string(50, '=') << "\n";
-        cout << " TIP: Commands are not case-sensitive!\n";
-        cout << string(50, '=') << "\n";
+        string cart;
+        if (!store || !store->get("cart/" + userKey(), cart))
+        {
+            cout << " Your cart is empty.\n";
+            return;
+        }
+        vector<string> fields = splitFields(cart);
+        Restaurant *selected = nullptr;
+        MenuItem item("", 0);
+        if (fields.size() < 3 || !findMenuItem(fields[0], fields[1], fields[2], selected, item))
+        {
+            cout << " The item in your cart is no longer on the menu.\n";
+            return;
+        }
+        cout << "\n YOUR CART: " << item.getName() << " from " << selected->getName() << "\n";
+        confirmOrder(selected, fields[1], item);
     }
 
-    // Shows a quick command summary
-    void showQuickCommands()
+    // Shows the live order pipeline and the load on each branch kitchen
+    void showKitchenStatus()
     {
-        cout << "\n Quick Commands:\n";
-        cout << "• help - Show full command guide\n";
-        cout << "• tell me about restaurants - Show all info\n";
-        cout << "• order - Place an order\n";
-        cout << "• recommend - Get recommendations under Rs 500\n";
-        cout << "• nearest branch - Find branches near you\n";
-        cout << "• [restaurant] open now - Check opening status\n";
-        cout << "• exit - Quit ChefBot\n";
+        cout << "\n ORDER PIPELINE:\n";
+        cout << string(70, '-') << "\n";
+        pipeline->printReport();
+        cout << "\n BRANCH KITCHENS:\n";
+        cout << string(70, '-') << "\n";
+        kitchen->printReport();
     }
 
-    // Displays details for all registered restaurants
-    void showAllInfo()
+    // Creates a new, empty scratch directory inside the data directory. create_directory
+    // fails on an existing name, so concurrent sessions never share or delete each other's.
+    static string makeScratchDir(const string &prefix)
     {
-        cout << "\n ALL RESTAURANTS INFORMATION:\n";
-        for (auto r : restaurants) // Iterate through each restaurant
-            r->showDetails();     // Call showDetails for each restaurant
+        filesystem::create_directories(dataDir);
+        random_device seed;
+        for (int attempt = 0; attempt < 100; attempt++)
+        {
+            ostringstream name;
+            name << dataDir << "/" << prefix << hex << seed();
+            if (filesystem::create_directory(name.str()))
+                return name.str();
+        }
+        throw runtime_error(string("could not create a scratch directory in ") + dataDir);
     }
 
-    // Displays specific information (name, rating, menu, address) for all restaurants
-    void showByField(string field)
+    // Pushes simulated orders through a scratch pipeline and reports its throughput.
+    // The scratch pipeline persists to its own store so real history is untouched.
+    void simulateOrders(size_t count)
     {
-        cout << "\n";
-        if (field == "name")
+        string dir;
+        try
         {
-            cout << " RESTAURANT NAMES:\n";
-            for (auto r : restaurants)
-                cout << "   • " << r->getName() << endl;
+            dir = makeScratchDir("simulation-");
+            vector<MenuEntry> menu = catalog.findItems("", numeric_limits<double>::max());
+            if (menu.empty())
+                return;
+
+            cout << "\n SIMULATING " << count << " ORDERS...\n";
+            KeyValueStore scratch(dir);
+            KitchenSimulator simKitchen(snapshot);
+            {
+                OrderPipeline simulation(*pricing, &scratch, dir + "/order_history.txt", simKitchen);
+                mt19937 random(42); // Fixed seed so runs are comparable
+                auto begin = chrono::steady_clock::now();
+                for (size_t i = 0; i < count; i++)
+                {
+                    const MenuEntry &entry = menu[random() % menu.size()];
+                    OrderTicket ticket;
+                    ticket.user = "sim" + to_string(i % 100);
+                    ticket.restaurant = entry.restaurantName;
+                    ticket.category = entry.category;
+                    ticket.item = (i % 100 == 99) ? "Unknown Item" : entry.itemName; // 1% invalid, to exercise validation
+                    ticket.placed = time(0);
+                    simulation.submit(ticket);
+                }
+                simulation.waitUntilIdle();
+                double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+                cout << string(70, '-') << "\n";
+                cout << " " << count << " orders in " << seconds * 1000 << " ms ("
+                     << static_cast<long>(count / max(seconds, 1e-9)) << " orders/s)\n";
+                simulation.printReport();
+                cout << "\n SIMULATED BRANCH KITCHENS:\n";
+                cout << string(70, '-') << "\n";
+                simKitchen.printReport();
+            }
         }
-        else if (field == "rating")
+        catch (const exception &e)
         {
-            cout << " RESTAURANT RATINGS:\n";
-            for (auto r : restaurants)
-                cout << "   • " << r->getName() << ": " << r->getRating() << "/5\n";
+            cout << " Simulation failed: " << e.what() << "\n";
         }
-        else if (field == "menu" || field == "prices")
+        error_code ignored;
+        if (!dir.empty())
+            filesystem::remove_all(dir, ignored);
+    }
+
+    // Submits ratings from several threads to a scratch board while another thread keeps
+    // reading ratings from it, and reports throughput, read latency and consistency
+    void simulateRatings(size_t count)
+    {
+        size_t items = pricing->itemCount();
+        if (items == 0)
+            return;
+        RatingBoard board(snapshot.restaurantCount(), items);
+        vector<size_t> restaurantOf(items); // Restaurant of each item id
+        for (size_t r = 0; r < snapshot.restaurantCount(); r++)
+            fill(restaurantOf.begin() + pricing->firstItemOf(r), restaurantOf.end(), r);
+        vector<unique_ptr<Restaurant>> views; // Restaurants reading the scratch board, as the real ones read theirs
+        for (size_t r = 0; r < snapshot.restaurantCount(); r++)
         {
-            cout << " ALL RESTAURANT MENUS:\n";
-            for (auto r : restaurants)
+            views.push_back(make_unique<SnapshotRestaurant>(snapshot, r));
+            views.back()->attachRatings(&board.restaurant(r));
+        }
+
+        size_t writers = max<size_t>(2, thread::hardware_concurrency());
+        cout << "\n SIMULATING " << count << " RATINGS FROM " << writers << " THREADS...\n";
+
+        atomic<bool> done{false};
+        uint64_t reads = 0, inconsistent = 0;
+        double totalRead = 0, slowestRead = 0; // Microseconds
+        thread reader([&] {
+            vector<uint64_t> lastCount(views.size(), 0);
+            while (!done.load(memory_order_acquire))
             {
-                cout << "\n" << r->getName() << ":\n";
-                r->showMenu();
+                for (size_t r = 0; r < views.size(); r++)
+                {
+                    auto start = chrono::steady_clock::now();
+                    float shown = views[r]->getRating();
+                    RatingSnapshot view = board.restaurant(r).snapshot();
+                    double took = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+                    totalRead += took;
+                    slowestRead = max(slowestRead, took); // Includes any time the reader was descheduled
+                    // A snapshot must never go backwards, and its average and rating must be in range
+                    if (view.count < lastCount[r] || (view.count > 0 && (view.mean < 1 || view.mean > 5)) || shown < 1 || shown > 5)
+                        inconsistent++;
+                    lastCount[r] = view.count;
+                    reads++;
+                }
             }
+        });
+
+        auto begin = chrono::steady_clock::now();
+        vector<thread> pool;
+        for (size_t w = 0; w < writers; w++)
+        {
+            pool.emplace_back([&, w] {
+                mt19937 random(static_cast<unsigned>(w + 1)); // Fixed seeds so runs are comparable
+                for (size_t i = w; i < count; i += writers)
+                {
+                    size_t item = random() % items;
+                    board.submit(restaurantOf[item], item, 1 + random() % 5);
+                }
+            });
         }
-        else if (field == "address" || field == "branches")
+        for (auto &worker : pool)
+            worker.join();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+        done.store(true, memory_order_release);
+        reader.join();
+
+        uint64_t restaurantTotal = 0, itemTotal = 0; // Both must equal the number submitted
+        for (size_t r = 0; r < views.size(); r++)
+            restaurantTotal += board.restaurant(r).snapshot().count;
+        for (size_t i = 0; i < items; i++)
+            itemTotal += board.item(i).snapshot().count;
+
+        ostringstream report;
+        report << fixed << setprecision(1);
+        report << " " << count << " ratings in " << seconds * 1000 << " ms ("
+               << static_cast<long>(count / max(seconds, 1e-9)) << " ratings/s)\n";
+        report << setprecision(3);
+        report << " Reader: " << reads << " ratings read while writing, average " << totalRead / max<uint64_t>(reads, 1)
+               << " us, slowest " << slowestRead << " us\n";
+        report << " Totals: " << restaurantTotal << " by restaurant, " << itemTotal << " by item, "
+               << inconsistent << " inconsistent read(s)\n";
+        report << setprecision(1);
+        for (size_t r = 0; r < views.size(); r++)
+            report << "   • " << views[r]->getName() << ": " << views[r]->getRating() << "/5\n";
+        cout << string(70, '-') << "\n";
+        cout << report.str();
+    }
+
+    // Asks the signed-in user to rate their most recent order, and saves the rating and review
+    void rateLastOrder()
+    {
+        const size_t maxReviewLength = 200; // Reviews are kept short
+        if (!store)
         {
-            cout << " RESTAURANT ADDRESSES:\n";
-            for (auto r : restaurants)
+            cout << " Ratings are not available right now.\n";
+            return;
+        }
+        pipeline->waitUntilIdle(); // Make sure orders just placed have been persisted
+        auto last = store->scanNewest("orders/" + userKey() + "/", 1);
+        if (last.empty())
+        {
+            cout << " No confirmed order to rate yet. Use 'order' to place one!\n";
+            return;
+        }
+        string ratedKey = "rated/" + last.front().first.substr(7); // orders/<user>/<n> -> rated/<user>/<n>
+        string previous;
+        if (store->get(ratedKey, previous))
+        {
+            cout << " You already gave your last order " << previous << " star(s). Thanks!\n";
+            return;
+        }
+        vector<string> fields = splitFields(last.front().second);
+        int restaurant = fields.size() >= 3 ? findRestaurant(fields[0]) : -1;
+        size_t itemId = 0;
+        if (restaurant < 0 || !pricing->findItem(fields[0], fields[2], itemId))
+        {
+            cout << " Your last order is no longer on the menu.\n";
+            return;
+        }
+
+        string answer;
+        cout << "\n How was your " << fields[2] << " from " << fields[0] << "?\n";
+        cout << "Rate it from 1 to 5 stars (press Enter to skip): ";
+        readAnswer(answer);
+        answer = trim(answer);
+        if (answer.empty())
+        {
+            cout << " No rating saved.\n";
+            return;
+        }
+        if (answer.size() != 1 || answer[0] < '1' || answer[0] > '5')
+        {
+            cout << " Please rate from 1 to 5 stars. No rating saved.\n";
+            return;
+        }
+        int stars = answer[0] - '0';
+
+        string review;
+        cout << "Short review (press Enter to skip): ";
+        readAnswer(review);
+        review = trim(review);
+        replace(review.begin(), review.end(), '\t', ' '); // Tabs separate the stored fields
+        if (review.size() > maxReviewLength)
+            review.resize(maxReviewLength);
+
+        ratings->submit(restaurant, itemId, stars);
+        RatingSnapshot view = ratings->restaurant(restaurant).snapshot();
+        try
+        {
+            string name = toLower(fields[0]);
+            ostringstream key;
+            key << "reviews/" << name << "/" << setw(10) << setfill('0') << view.count; // Zero-padded so keys sort by age
+            store->putAll({{"ratings/" + name, encodeStars(view)},
+                           {"ratings/" + name + "/" + toLower(fields[2]), encodeStars(ratings->item(itemId).snapshot())},
+                           {key.str(), currentUser + '\t' + fields[2] + '\t' + to_string(stars) + '\t' + review},
+                           {ratedKey, to_string(stars)}});
+        }
+        catch (const exception &e)
+        {
+            cout << " Warning: Could not save your rating: " << e.what() << "\n";
+        }
+        ostringstream thanks; // One decimal, as 'reviews' shows it
+        thanks << fixed << setprecision(1) << " Thanks for rating! " << fields[0] << " is now rated "
+               << view.blendedWith(snapshot.restaurantRating(restaurant)) << "/5.\n";
+        cout << thanks.str();
+    }
+
+    // Shows a restaurant's rating breakdown, its rated items and its latest reviews
+    void showReviews(const string &restName)
+    {
+        int r = findRestaurant(restName);
+        if (r < 0)
+        {
+            cout << " '" << restName << "' is not a recognized restaurant.\n";
+            cout << "Available restaurants: Cheezious, Ranchers, Howdy\n";
+            return;
+        }
+
+        RatingSnapshot view = ratings->restaurant(r).snapshot();
+        ostringstream out;
+        out << fixed << setprecision(1);
+        out << "\n RATINGS AND REVIEWS FOR " << snapshot.restaurantName(r) << ":\n";
+        out << string(50, '-') << "\n";
+        out << " Rating: " << view.blendedWith(snapshot.restaurantRating(r)) << "/5";
+        if (view.count == 0)
+        {
+            out << " (no customer ratings yet - order and type 'rate' to add one)\n";
+            cout << out.str();
+            return;
+        }
+        out << " (" << view.count << " customer rating" << (view.count == 1 ? "" : "s")
+            << ", average " << view.mean << ")\n";
+        for (int s = 5; s >= 1; s--) // Distribution, best first
+        {
+            uint64_t n = view.stars[s - 1];
+            out << "   " << s << " star  " << left << setw(20) << string(n * 20 / view.count, '#') << right << " " << n << "\n";
+        }
+
+        out << "\n Rated items:\n";
+        size_t id = pricing->firstItemOf(r);
+        for (size_t c = 0; c < snapshot.categoryCount(r); c++)
+        {
+            for (size_t i = 0; i < snapshot.itemCount(r, c); i++, id++)
             {
-                cout << "\n" << r->getName() << ":\n";
-                for (auto a : r->getAddresses())
-                    cout << "   • " << a << endl;
+                RatingSnapshot item = ratings->item(id).snapshot();
+                if (item.count > 0)
+                    out << "   • " << snapshot.itemName(r, c, i) << ": " << item.mean << "/5 (" << item.count << ")\n";
             }
         }
-        else
+
+        auto reviews = store ? store->scanNewest("reviews/" + toLower(string(snapshot.restaurantName(r))) + "/", 5)
+                             : vector<pair<string, string>>();
+        if (!reviews.empty())
+            out << "\n Latest reviews:\n";
+        for (const auto &review : reviews)
         {
-            cout << " Sorry, I don't understand that field.\n";
-            cout << "Try: names, ratings, menu, addresses, or branches\n";
+            vector<string> fields = splitFields(review.second);
+            if (fields.size() < 3)
+                continue;
+            out << "   • " << fields[2] << "/5 for " << fields[1] << " by " << fields[0];
+            if (fields.size() > 3 && !fields[3].empty())
+                out << ": \"" << fields[3] << "\"";
+            out << "\n";
         }
+        cout << out.str();
     }
 
     // Handles the order process
@@ -372,17 +3632,10 @@ public:
         cout << "Which restaurant would you like to order from?\n";
         cout << "Available: Cheezious, Ranchers, Howdy\n";
         cout << "Enter restaurant name: ";
-        getline(cin, restName); // Get restaurant name from user
+        readAnswer(restName); // Get restaurant name from user
 
-        Restaurant *selected = nullptr; // Pointer to store the selected restaurant
-        for (auto r : restaurants)      // Iterate through restaurants to find a match
-        {
-            if (toLower(r->getName()) == toLower(restName))
-            {
-                selected = r; // Found the restaurant
-                break;
-            }
-        }
+        int index = findRestaurant(restName); // Look the name up in the snapshot
+        Restaurant *selected = index >= 0 ? restaurantAt(index) : nullptr; // Pointer to store the selected restaurant
 
         if (!selected) // If no restaurant was found
         {
@@ -391,11 +3644,12 @@ public:
             return;
         }
 
-        selected->showDetails(); // Show details of the selected restaurant
+        vector<double> prices = pricing->evaluate(time(0)); // Current prices, deals included
+        selected->showDetails(pricesFor(prices, selected)); // Show details of the selected restaurant
 
         string category;
         cout << "\nWhich category would you like to order from? ";
-        getline(cin, category); // Get category from user
+        readAnswer(category); // Get category from user
 
         auto menu = selected->getCategorizedMenu(); // Get the menu of the selected restaurant
         if (menu.find(category) == menu.end())     // Check if the category exists
@@ -409,68 +3663,24 @@ public:
         }
 
         cout << "\n Available items in " << category << ":\n";
-        for (auto &item : menu[category]) // Display items in the selected category
-            item.show();
+        for (auto &item : menu[category]) // Display items in the selected category at their current prices
+        {
+            size_t itemId = 0;
+            if (pricing->findItem(selected->getName(), item.getName(), itemId))
+                item.show(prices[itemId]);
+            else
+                item.show();
+        }
 
         string itemName;
         cout << "\nEnter item name: ";
-        getline(cin, itemName); // Get item name from user
+        readAnswer(itemName); // Get item name from user
 
         for (auto &item : menu[category]) // Iterate through items in the category to find a match
         {
             if (toLower(item.getName()) == toLower(itemName))
             {
-                cout << "\n ORDER SUMMARY:\n";
-                cout << "Restaurant: " << selected->getName() << "\n";
-                cout << "Item: " << item.getName() << "\n";
-                cout << "Price: Rs " << item.getPrice() << "\n";
-                
-                string confirm;
-                cout << "\nConfirm order? (yes/no): ";
-                getline(cin, confirm); // Ask for order confirmation
-
-                if (toLower(confirm) == "yes" || toLower(confirm) == "y") // If user confirms
-                {
-                    double tax = 0.15 * item.getPrice(); // Calculate 15% tax
-                    cout << "\n ORDER CONFIRMED!\n";
-                    cout << string(25, '-') << "\n";
-                    cout << " BILL SUMMARY:\n";
-                    cout << "Item: " << item.getName() << " - Rs " << fixed << setprecision(2) << item.getPrice() << "\n";
-                    cout << "Tax (15%): Rs " << tax << "\n";
-                    cout << "Total: Rs " << item.getPrice() + tax << "\n";
-                    cout << string(25, '-') << "\n";
-
-                    // Log the order to a file
-                    try
-                    {
-                        ofstream fout("order_history.txt", ios::app); // Open file in append mode
-                        if (fout) // Check if file opened successfully
-                        {
-                            fout << "Restaurant: " << selected->getName() << "\n";
-                            fout << "Item: " << item.getName() << "\n";
-                            fout << "Price: Rs " << item.getPrice() << "\n";
-                            fout << "Tax: Rs " << tax << "\n";
-                            fout << "Total: Rs " << item.getPrice() + tax << "\n";
-                            fout << "-----------------------------\n";
-                            fout.close(); // Close the file
-                            cout << " Order logged successfully.\n";
-                        }
-                        else
-                        {
-                            cout << " Warning: Could not log order to file.\n";
-                        }
-                    }
-                    catch (...)
-                    {
-                        cout << " Warning: Error occurred while logging order.\n";
-                    }
-                    
-                    cout << " Your order will be prepared shortly!\n";
-                }
-                else // If order is canceled
-                {
-                    cout << " Order canceled.\n";
-                }
+                confirmOrder(selected, category, item); // Show the summary and ask for confirmation
                 return; // Exit after handling the order
             }
         }
@@ -478,6 +3688,130 @@ public:
         cout << " Item '" << itemName << "' not found in " << category << ".\n"; // If item was not found in the category
     }
 
+    // Shows the order summary, asks for confirmation and bills, logs and records the order
+    void confirmOrder(Restaurant *selected, const string &category, const MenuItem &item)
+    {
+        size_t itemId = 0;
+        if (!pricing->findItem(selected->getName(), item.getName(), itemId))
+        {
+            cout << " Item '" << item.getName() << "' is no longer on the menu.\n";
+            return;
+        }
+
+        string branch;
+        cout << "\nWhich branch? (";
+        vector<string> branches = selected->getBranches();
+        for (size_t i = 0; i < branches.size(); i++)
+            cout << (i == 0 ? "" : ", ") << branches[i];
+        cout << ", or press Enter for the first available): ";
+        readAnswer(branch); // Branch prices may differ
+        branch = trim(branch);
+        int branchId = branch.empty() ? -1 : pricing->findBranch(selected->getName(), branch);
+        if (!branch.empty() && branchId < 0)
+        {
+            cout << " Branch '" << branch << "' not found. The first available branch will prepare it.\n";
+            branch.clear();
+        }
+        for (const auto &name : branches) // Use the branch's proper spelling
+        {
+            if (toLower(name) == toLower(branch))
+                branch = name;
+        }
+
+        int quantity = 1;
+        string amount;
+        cout << "How many? (press Enter for 1): ";
+        readAnswer(amount);
+        try
+        {
+            if (!trim(amount).empty())
+                quantity = stoi(amount);
+        }
+        catch (const exception &)
+        {
+            quantity = 0;
+        }
+        if (quantity < 1 || quantity > 50)
+        {
+            cout << " Please order between 1 and 50 items. Using 1.\n";
+            quantity = 1;
+        }
+
+        string coupon;
+        cout << "Coupon code (press Enter to skip): ";
+        readAnswer(coupon);
+        coupon = trim(coupon);
+        transform(coupon.begin(), coupon.end(), coupon.begin(), ::toupper); // Codes are not case-sensitive
+
+        time_t placed = time(0);
+        OrderQuote quote = pricing->quote(itemId, quantity, placed, branchId, coupon);
+        if (!coupon.empty() && !quote.couponAccepted)
+        {
+            cout << " Coupon '" << coupon << "' is not valid for this order.\n";
+            coupon.clear();
+        }
+
+        cout << "\n ORDER SUMMARY:\n";
+        cout << "Restaurant: " << selected->getName() << "\n";
+        if (!branch.empty())
+            cout << "Branch: " << branch << "\n";
+        cout << "Item: " << item.getName() << "\n";
+        cout << "Price: Rs " << quote.unitPrice;
+        if (quote.unitPrice < item.getPrice())
+            cout << " (was Rs " << item.getPrice() << ")";
+        cout << "\n";
+        if (quantity > 1)
+            cout << "Quantity: " << quantity << "\n";
+
+        string confirm;
+        cout << "\nConfirm order? (yes/no): ";
+        readAnswer(confirm); // Ask for order confirmation
+
+        if (toLower(confirm) == "yes" || toLower(confirm) == "y") // If user confirms
+        {
+            cout << "\n ORDER CONFIRMED!\n";
+            cout << string(25, '-') << "\n";
+            cout << " BILL SUMMARY:\n";
+            ios format(nullptr);
+            format.copyfmt(cout); // The bill shows paisa; restore the plain format afterwards
+            cout << "Item: " << item.getName();
+            if (quantity > 1)
+                cout << " x" << quantity;
+            cout << " - Rs " << fixed << setprecision(2) << quote.subtotal << "\n";
+            if (quote.bundleDiscount > 0)
+                cout << "Bundle discount: -Rs " << quote.bundleDiscount << "\n";
+            if (quote.couponAccepted)
+                cout << "Coupon " << coupon << ": -Rs " << quote.couponDiscount << "\n";
+            cout << "Tax (15%): Rs " << quote.tax << "\n";
+            cout << "Total: Rs " << quote.total << "\n";
+            cout << string(25, '-') << "\n";
+            cout.copyfmt(format);
+
+            // Hand the order to the dispatch pipeline, which prices, logs and sends it to a branch
+            OrderTicket ticket;
+            ticket.user = currentUser;
+            ticket.restaurant = selected->getName();
+            ticket.category = category;
+            ticket.item = item.getName();
+            ticket.quantity = quantity;
+            ticket.coupon = coupon;
+            ticket.branch = branch;
+            ticket.placed = placed; // Same time as the quote, so the pipeline bills the same price
+            long number = pipeline->submit(ticket);
+            clearCart(); // The order supersedes any saved cart
+
+            cout << " Order #" << number << " sent to the kitchen.\n";
+            cout << " Your order will be prepared shortly!\n";
+            if (store)
+                cout << " Type 'rate' after your meal to rate it.\n";
+        }
+        else // If order is canceled
+        {
+            saveCart(selected->getName(), category, item);
+            cout << " Order canceled.\n";
+        }
+    }
+
     // Recommends all menu items under 500 Rs based on optional keyword
     void recommend(string keyword = "")
     {
@@ -487,7 +3821,7 @@ public:
         if (keyword.empty())
         {
             cout << "Enter item keyword (burger, pizza, pasta, wrap, sandwich) or press Enter for all: ";
-            getline(cin, keyword);
+            readAnswer(keyword);
         }
 
         bool found = false; // Flag to track if any recommendations are found
@@ -497,30 +3831,22 @@ public:
         cout << ":\n";
         cout << string(50, '-') << "\n";
 
-        for (auto r : restaurants) // Iterate through each restaurant
+        vector<double> prices = pricing->evaluate(time(0)); // Current price of every item, deals included
+        double searchLimit = maxPrice / max(1e-9, 1.0 - pricing->maxDealPercent()); // Deals can bring dearer items under the limit
+        const MenuEntry *previous = nullptr;
+        for (const auto &entry : catalog.findItems(keyword, searchLimit)) // Matches from every shard, in catalog order
         {
-            auto menu = r->getCategorizedMenu(); // Get the restaurant's menu
-            bool restaurantHasItems = false;
-            
-            for (const auto &category : menu) // Iterate through all categories
-            {
-                for (const auto &item : category.second) // Iterate through items in each category
-                {
-                    if (item.getPrice() <= maxPrice) // Check if item price is within limit
-                    {
-                        // Check if keyword is empty or if item name contains the keyword
-                        if (keyword.empty() || toLower(item.getName()).find(toLower(keyword)) != string::npos)
-                        {
-                            if (!restaurantHasItems) {
-                                cout << "\n " << r->getName() << ":\n";
-                                restaurantHasItems = true;
-                            }
-                            cout << "   • " << item.getName() << " (" << category.first << ") - Rs " << item.getPrice() << "\n";
-                            found = true; // Set found flag to true
-                        }
-                    }
-                }
-            }
+            double price = prices[pricing->firstItemOf(entry.restaurant) + entry.order];
+            if (price > maxPrice) // Check if item price is within limit
+                continue;
+            if (previous == nullptr || previous->restaurant != entry.restaurant)
+                cout << "\n " << entry.restaurantName << ":\n";
+            cout << "   • " << entry.itemName << " (" << entry.category << ") - Rs " << price;
+            if (price < entry.price)
+                cout << " (was Rs " << entry.price << ")";
+            cout << "\n";
+            previous = &entry;
+            found = true; // Set found flag to true
         }
 
         if (found) // If recommendations were found, log them
@@ -558,72 +3884,68 @@ public:
         cout << "\n BRANCH FINDER\n";
         cout << string(20, '-') << "\n";
         cout << "Enter city name (e.g., Islamabad, Lahore): ";
-        getline(cin, city); // Get city name from user
+        readAnswer(city); // Get city name from user
 
         bool found = false; // Flag to track if any branches are found
         cout << "\n Branches in " << city << ":\n";
         cout << string(30, '-') << "\n";
         
-        for (auto r : restaurants) // Iterate through each restaurant
+        const BranchEntry *previous = nullptr;
+        for (const auto &entry : catalog.findBranches(city)) // Answered by the city's shard when the city is known
         {
-            vector<string> addresses = r->getAddresses();
-            vector<string> branches = r->getBranches();
-            
-            bool restaurantFound = false;
-            for (size_t i = 0; i < addresses.size(); i++) // Iterate through each address of the restaurant
-            {
-                if (toLower(addresses[i]).find(toLower(city)) != string::npos) // Check if address contains the city
-                {
-                    if (!restaurantFound) {
-                        cout << "\n " << r->getName() << ":\n";
-                        restaurantFound = true;
-                    }
-                    cout << "   • " << branches[i] << " Branch\n";
-                    cout << "     " << addresses[i] << "\n";
-                    found = true; // Set found flag to true
-                }
-            }
+            if (previous == nullptr || previous->restaurant != entry.restaurant)
+                cout << "\n " << entry.restaurantName << ":\n";
+            cout << "   • " << entry.branch << " Branch\n";
+            cout << "     " << entry.address << "\n";
+            previous = &entry;
+            found = true; // Set found flag to true
         }
 
         if (!found) // If no branches found in the specified city
         {
             cout << " No branches found in '" << city << "'.\n";
-            cout << "Available cities: Islamabad, Lahore\n";
+            cout << "Available cities:";
+            vector<string> cities = catalog.getCities();
+            for (size_t i = 0; i < cities.size(); i++)
+                cout << (i == 0 ? " " : ", ") << cities[i];
+            cout << "\n";
         }
     }
 
     // Checks and displays the open/closed status of a specific restaurant
     void checkOpenStatus(string restName)
     {
-        bool restaurantFound = false;
-        
-        for (auto r : restaurants) // Iterate through each restaurant
+        int index = findRestaurant(restName);
+        if (index < 0)
         {
-            if (toLower(r->getName()) == toLower(restName))
-            {
-                restaurantFound = true;
-                cout << "\n OPENING STATUS:\n";
-                cout << string(20, '-') << "\n";
-                if (r->isOpenNow()) // Check if the restaurant is open
-                {
-                    cout << " " << r->getName() << " is OPEN now! (12 PM - 11 PM)\n";
-                }
-                else // If the restaurant is closed
-                {
-                    cout << " " << r->getName() << " is CLOSED now.\n";
-                    cout << "Opening hours: 12 PM - 11 PM\n";
-                }
-                break; // Stop after finding the restaurant
-            }
+            cout << " '" << restName << "' is not a recognized restaurant.\n";
+            cout << "Available restaurants: Cheezious, Ranchers, Howdy\n";
+            return;
         }
 
-        if (!restaurantFound)
+        Restaurant *r = restaurantAt(index);
+        cout << "\n OPENING STATUS:\n";
+        cout << string(20, '-') << "\n";
+        if (r->isOpenNow()) // Check if the restaurant is open
         {
-            cout << " '" << restName << "' is not a recognized restaurant.\n";
-            cout << "Available restaurants: Cheezious, Ranchers, Howdy\n";
+            cout << " " << r->getName() << " is OPEN now! (12 PM - 11 PM)\n";
+        }
+        else // If the restaurant is closed
+        {
+            cout << " " << r->getName() << " is CLOSED now.\n";
+            cout << "Opening hours: 12 PM - 11 PM\n";
         }
     }
 
+    // Warns about orders the pipeline could not write to the history file since the last warning
+    void reportUnloggedOrders()
+    {
+        uint64_t unlogged = pipeline->unloggedOrders();
+        if (unlogged > unloggedWarned)
+            cout << " Warning: Could not log " << unlogged - unloggedWarned << " order(s) to file.\n";
+        unloggedWarned = unlogged;
+    }
+
     // Main function to handle user input and direct to appropriate functions
     void handleInput(string input)
     {
@@ -642,110 +3964,153 @@ public:
             // Silent failure for chat logging to not interrupt user experience
         }
 
+        reportUnloggedOrders(); // Orders are logged in the background, so failures surface here
+        queryReceived = chrono::steady_clock::now(); // For the first-query latency in the startup report
         string lowerInput = toLower(input); // Convert input to lowercase for easier comparison
 
-        // Check for help requests
-        if (lowerInput == "help" || lowerInput == "commands" || lowerInput == "what can you do")
+        switch (parseCommand(lowerInput)) // Dispatch through the constexpr command grammar
         {
+        case Command::Help:
             showHelp();
+            break;
+
+        case Command::Recommend:
+        {
+            int food = firstKeyword(lowerInput, KeywordKind::Food); // Extract keyword if present
+            recommend(food < 0 ? "" : string(foodKeywords[food]));
+            break;
         }
-        // Check for recommendation requests (now for all menu items under 500)
-        else if (lowerInput.find("recommend") != string::npos || 
-            (lowerInput.find("tell me about") != string::npos && lowerInput.find("under") != string::npos))
-        {
-            string keyword = "";
-            // Extract keyword if present
-            if (lowerInput.find("burger") != string::npos)
-                keyword = "burger";
-            else if (lowerInput.find("pizza") != string::npos)
-                keyword = "pizza";
-            else if (lowerInput.find("pasta") != string::npos)
-                keyword = "pasta";
-            else if (lowerInput.find("wrap") != string::npos)
-                keyword = "wrap";
-            else if (lowerInput.find("sandwich") != string::npos)
-                keyword = "sandwich";
-            
-            recommend(keyword);
+
+        case Command::Order:
+            order();
+            break;
+
+        case Command::Login:
+        {
+            size_t start = lowerInput.find("my name is");
+            start = (start == string::npos) ? lowerInput.find("login") + 5 : start + 10;
+            login(input.substr(start)); // Keep the name as typed
+            break;
         }
-        // Check for order requests
-        else if (lowerInput.find("order") != string::npos || lowerInput.find("place order") != string::npos)
+
+        case Command::History:
         {
-            order();
+            size_t count = 5;
+            size_t digits = lowerInput.find_first_of("0123456789");
+            if (digits != string::npos)
+                count = max<size_t>(1, stoul(lowerInput.substr(digits, 3))); // e.g. "my last 10 orders"
+            showOrderHistory(count);
+            break;
         }
-        // Check for nearest branch requests
-        else if (lowerInput.find("nearest") != string::npos || lowerInput.find("branch") != string::npos || lowerInput.find("find branches") != string::npos)
+
+        case Command::Reorder:
+            reorder();
+            break;
+
+        case Command::Cart:
+            showCart();
+            break;
+
+        case Command::Deals:
+            showDeals();
+            break;
+
+        case Command::KitchenStatus:
+            showKitchenStatus();
+            break;
+
+        case Command::Simulate:
         {
-            nearestBranch();
+            bool ratingsTest = lowerInput.find("rating") != string::npos;
+            size_t count = ratingsTest ? 100000 : 5000;
+            size_t digits = lowerInput.find_first_of("0123456789");
+            if (digits != string::npos)
+                count = max<size_t>(1, stoul(lowerInput.substr(digits, 7))); // e.g. "simulate 20000 orders"
+            if (ratingsTest)
+                simulateRatings(count);
+            else
+                simulateOrders(count);
+            break;
+        }
+
+        case Command::Rate:
+            rateLastOrder();
+            break;
+
+        case Command::Reviews:
+        {
+            int restaurant = firstKeyword(lowerInput, KeywordKind::Restaurant);
+            if (restaurant >= 0)
+                showReviews(string(restaurantKeywords[restaurant]));
+            else
+            {
+                cout << " Please specify which restaurant's reviews you want to see.\n";
+                cout << "Available: Cheezious, Ranchers, Howdy\n";
+                cout << "Example: 'reviews cheezious'\n";
+            }
+            break;
         }
-        // Check for open status requests for specific restaurants
-        else if (lowerInput.find("open now") != string::npos || lowerInput.find("open status") != string::npos)
+
+        case Command::OpenStatus:
         {
-            if (lowerInput.find("cheezious") != string::npos)
-                checkOpenStatus("cheezious");
-            else if (lowerInput.find("ranchers") != string::npos)
-                checkOpenStatus("ranchers");
-            else if (lowerInput.find("howdy") != string::npos)
-                checkOpenStatus("howdy");
+            int restaurant = firstKeyword(lowerInput, KeywordKind::Restaurant);
+            if (restaurant >= 0)
+                checkOpenStatus(string(restaurantKeywords[restaurant]));
             else
             {
                 cout << " Please specify which restaurant's opening status you want to check.\n";
                 cout << "Available: Cheezious, Ranchers, Howdy\n";
                 cout << "Example: 'cheezious open now'\n";
             }
+            break;
         }
-        // Check for "tell me about" requests (broadest category, checked last)
-        else if (lowerInput.find("tell me about") != string::npos)
+
+        case Command::TellAbout:
         {
-            // Check if a specific restaurant name is mentioned
-            if (lowerInput.find("cheezious") != string::npos ||
-                lowerInput.find("ranchers") != string::npos ||
-                lowerInput.find("howdy") != string::npos)
+            unsigned mentioned = keywordMask(lowerInput, KeywordKind::Restaurant);
+            int field = firstKeyword(lowerInput, KeywordKind::Field);
+            if (mentioned != 0) // Check if a specific restaurant name is mentioned
             {
-                for (auto r : restaurants)
+                vector<double> prices = pricing->evaluate(time(0)); // Current prices, deals included
+                for (size_t i = 0; i < snapshot.restaurantCount(); i++)
                 {
-                    if (lowerInput.find(toLower(r->getName())) != string::npos)
-                        r->showDetails(); // Show details for the mentioned restaurant
+                    if (keywordMask(toLower(string(snapshot.restaurantName(i))), KeywordKind::Restaurant) & mentioned)
+                        restaurantAt(i)->showDetails(pricesFor(prices, restaurantAt(i))); // Show details for the mentioned restaurant
                 }
             }
-            // Check for specific fields within "tell me about"
-            else if (lowerInput.find("name") != string::npos ||
-                     lowerInput.find("address") != string::npos ||
-                     lowerInput.find("menu") != string::npos ||
-                     lowerInput.find("branches") != string::npos ||
-                     lowerInput.find("rating") != string::npos ||
-                     lowerInput.find("prices") != string::npos)
-            {
-                // Call showByField for each identified field
-                if (lowerInput.find("name") != string::npos)
-                    showByField("name");
-                else if (lowerInput.find("address") != string::npos)
-                    showByField("address");
-                else if (lowerInput.find("menu") != string::npos)
-                    showByField("menu");
-                else if (lowerInput.find("branches") != string::npos)
-                    showByField("branches");
-                else if (lowerInput.find("rating") != string::npos)
-                    showByField("rating");
-                else if (lowerInput.find("prices") != string::npos)
-                    showByField("prices");
-            }
-            else if (lowerInput.find("restaurants") != string::npos)
+            else if (field >= 0 && fieldKeywords[field] == "restaurants")
             {
                 showAllInfo(); // Show all restaurant info
             }
+            else if (field >= 0) // Show the requested field for every restaurant
+            {
+                showByField(string(fieldKeywords[field]));
+            }
             else
             {
                 cout << " I need more specific information. Try:\n";
                 showQuickCommands();
             }
+            break;
         }
-        else // If no recognized command
-        {
+
+        case Command::NearestBranch:
+            nearestBranch();
+            break;
+
+        case Command::StartupReport:
+            showStartupReport();
+            break;
+
+        case Command::Exit:    // Exit is handled by the main loop
+        case Command::Unknown: // If no recognized command
             cout << " Sorry, I don't understand '" << input << "'.\n";
             cout << "Type 'help' to see all available commands.\n";
             showQuickCommands();
+            break;
         }
+
+        stopFirstQueryClock(false);
     }
 
     // Destructor to free dynamically allocated Restaurant objects
@@ -774,8 +4139,7 @@ int main()
             getline(cin, userInput); // Get complete line of user input
             
             // Check if user wants to exit the program
-            if (toLower(userInput) == "exit" || toLower(userInput) == "quit" || 
-                toLower(userInput) == "bye" || toLower(userInput) == "goodbye")
+            if (parseCommand(toLower(userInput)) == Command::Exit)
             {
                 cout << "\n" << string(40, '=') << "\n";
                 cout << " Thank you for using ChefBot!\n";